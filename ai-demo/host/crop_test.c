@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dmac_sim.h"
+#include "image_process.h"
+
+typedef struct
+{
+    uint16_t w_src, h_src;
+    uint16_t x, y;
+    uint16_t w_dst, h_dst;
+} crop_case_t;
+
+/* Small and large, odd and aligned, full-width and windowed, up to a whole frame */
+static const crop_case_t cases[] = {
+    {37, 29, 3, 5, 17, 11},       {37, 29, 0, 0, 37, 29},      {320, 240, 0, 0, 320, 240},
+    {320, 240, 0, 17, 320, 200},  {321, 243, 7, 9, 101, 97},   {320, 240, 32, 16, 128, 128},
+    {322, 240, 2, 1, 130, 64},    {256, 256, 1, 1, 255, 255},  {224, 224, 0, 95, 224, 129},
+};
+
+static int crop_done;
+
+static int on_crop_done(void *ctx)
+{
+    (*(int *)ctx)++;
+    return 0;
+}
+
+/* shift moves the buffers off alignment so every DMA beat width is used */
+static uint8_t *alloc_image(image_t *image, uint16_t width, uint16_t height, uint32_t shift)
+{
+    uint8_t *buf = malloc((size_t)width * height * 3 + 8);
+
+    image->width = width;
+    image->height = height;
+    image->pixel = 3;
+    image->addr = buf + shift;
+    return buf;
+}
+
+static uint32_t check(const crop_case_t *c, const image_t *src, const image_t *dst)
+{
+    uint32_t plane_src = c->w_src * c->h_src, plane_dst = c->w_dst * c->h_dst;
+    uint32_t wrong = 0;
+
+    for (uint32_t k = 0; k < 3; k++)
+        for (uint32_t y = 0; y < c->h_dst; y++)
+            for (uint32_t x = 0; x < c->w_dst; x++)
+                wrong += dst->addr[k * plane_dst + y * c->w_dst + x] !=
+                         src->addr[k * plane_src + (c->y + y) * c->w_src + c->x + x];
+    return wrong;
+}
+
+int main(void)
+{
+    uint32_t failed = 0;
+
+    for (uint32_t n = 0; n < sizeof(cases) / sizeof(cases[0]); n++)
+    {
+        for (uint32_t shift = 0; shift < 4; shift++)
+        {
+            const crop_case_t *c = &cases[n];
+            image_t src, dst;
+            uint8_t *src_buf = alloc_image(&src, c->w_src, c->h_src, shift);
+            uint8_t *dst_buf = alloc_image(&dst, c->w_dst, c->h_dst, shift & 1);
+            uint32_t sync_wrong, async_wrong;
+            dmac_sim_stats_t stats;
+
+            for (uint32_t i = 0; i < (uint32_t)c->w_src * c->h_src * 3; i++)
+                src.addr[i] = (uint8_t)(i * 7 + i / 251);
+
+            memset(dst.addr, 0, (size_t)c->w_dst * c->h_dst * 3);
+            image_crop(&src, &dst, c->x, c->y);
+            sync_wrong = check(c, &src, &dst);
+
+            memset(dst.addr, 0, (size_t)c->w_dst * c->h_dst * 3);
+            dmac_sim_reset_stats();
+            crop_done = 0;
+            if (image_crop_async(&src, &dst, c->x, c->y, DMAC_CHANNEL1, on_crop_done, &crop_done) != 0)
+                crop_done = -1;
+            dmac_sim_run();
+            dmac_sim_get_stats(&stats);
+            async_wrong = check(c, &src, &dst);
+
+            if (sync_wrong || async_wrong || crop_done != 1 || image_crop_busy() || stats.errors)
+            {
+                printf("FAIL %3ux%-3u at (%u,%u) -> %3ux%-3u, shift %u: %u/%u wrong, %d callbacks, %u dma errors\n",
+                       c->w_src, c->h_src, c->x, c->y, c->w_dst, c->h_dst, shift, sync_wrong, async_wrong,
+                       crop_done, stats.errors);
+                failed++;
+            }
+            else if (shift == 0)
+            {
+                printf("ok   %3ux%-3u at (%u,%u) -> %3ux%-3u, %u dma transfers\n", c->w_src, c->h_src, c->x, c->y,
+                       c->w_dst, c->h_dst, stats.transfers);
+            }
+            free(src_buf);
+            free(dst_buf);
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,85 @@
+#include <string.h>
+#include "dmac.h"
+#include "dmac_sim.h"
+
+static struct
+{
+    const uint8_t *src;
+    uint8_t *dst;
+    size_t bytes;
+    int pending;
+    plic_irq_callback_t callback;
+    void *ctx;
+} channels[DMAC_CHANNEL_MAX];
+
+static dmac_sim_stats_t stats;
+
+void dmac_set_single_mode(dmac_channel_number_t channel_num, const void *src, void *dest,
+                          dmac_address_increment_t src_inc, dmac_address_increment_t dest_inc,
+                          dmac_burst_trans_length_t dmac_burst_size, dmac_transfer_width_t dmac_trans_width,
+                          size_t block_size)
+{
+    size_t width = (size_t)1 << dmac_trans_width;
+
+    (void)dmac_burst_size;
+    if (channel_num >= DMAC_CHANNEL_MAX || channels[channel_num].pending || block_size == 0 ||
+        block_size > DMAC_SIM_MAX_BLOCK || ((uintptr_t)src | (uintptr_t)dest) & (width - 1) ||
+        src_inc != DMAC_ADDR_INCREMENT || dest_inc != DMAC_ADDR_INCREMENT)
+    {
+        stats.errors++;
+        return;
+    }
+    channels[channel_num].src = src;
+    channels[channel_num].dst = dest;
+    channels[channel_num].bytes = block_size * width;
+    channels[channel_num].pending = 1;
+}
+
+void dmac_irq_register(dmac_channel_number_t channel_num, plic_irq_callback_t dmac_callback, void *ctx,
+                       uint32_t priority)
+{
+    (void)priority;
+    channels[channel_num].callback = dmac_callback;
+    channels[channel_num].ctx = ctx;
+}
+
+void dmac_irq_unregister(dmac_channel_number_t channel_num)
+{
+    channels[channel_num].callback = NULL;
+    channels[channel_num].ctx = NULL;
+}
+
+uint32_t dmac_sim_run(void)
+{
+    uint32_t count = 0;
+    int busy = 1;
+
+    while (busy)
+    {
+        busy = 0;
+        for (int k = 0; k < DMAC_CHANNEL_MAX; k++)
+        {
+            if (!channels[k].pending)
+                continue;
+            memmove(channels[k].dst, channels[k].src, channels[k].bytes);
+            channels[k].pending = 0;
+            stats.transfers++;
+            stats.bytes += channels[k].bytes;
+            count++;
+            busy = 1;
+            if (channels[k].callback)
+                channels[k].callback(channels[k].ctx);
+        }
+    }
+    return count;
+}
+
+void dmac_sim_get_stats(dmac_sim_stats_t *out)
+{
+    *out = stats;
+}
+
+void dmac_sim_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
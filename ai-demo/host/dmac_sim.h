@@ -0,0 +1,28 @@
+#ifndef _DMAC_SIM_H_
+#define _DMAC_SIM_H_
+
+#include <stdint.h>
+
+/* Largest block one transfer can move, in beats: BLOCK_TS is 22 bits */
+#define DMAC_SIM_MAX_BLOCK (1 << 22)
+
+typedef struct _dmac_sim_stats
+{
+    uint32_t transfers;
+    uint64_t bytes;
+    /* Transfers refused: too long, unaligned for their width, or on a busy channel */
+    uint32_t errors;
+} dmac_sim_stats_t;
+
+/*
+ * Host model of the memory-to-memory DMAC paths the image layer uses.
+ * dmac_set_single_mode only queues a transfer; it moves and raises the
+ * channel's interrupt when dmac_sim_run lets it, so the caller's
+ * asynchronous path runs exactly as it would between interrupts.
+ */
+/* Complete every queued transfer, including ones started from handlers; returns how many ran */
+uint32_t dmac_sim_run(void);
+void dmac_sim_get_stats(dmac_sim_stats_t *stats);
+void dmac_sim_reset_stats(void);
+
+#endif
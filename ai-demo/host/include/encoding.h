@@ -0,0 +1,14 @@
+#ifndef _HOST_ENCODING_H
+#define _HOST_ENCODING_H
+
+/*
+ * Host stand-in for the SDK header. Simulated interrupts run synchronously
+ * from the simulator, never in the middle of masked code, so masking only
+ * has to report interrupts as enabled.
+ */
+#define MSTATUS_MIE 0x00000008
+
+#define clear_csr(reg, bit) ((unsigned long)(bit))
+#define set_csr(reg, bit) ((void)(bit))
+
+#endif /* _HOST_ENCODING_H */
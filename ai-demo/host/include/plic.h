@@ -0,0 +1,7 @@
+#ifndef _HOST_PLIC_H
+#define _HOST_PLIC_H
+
+/* Host stand-in for the SDK header: only the callback type dmac.h and the image layer use */
+typedef int (*plic_irq_callback_t)(void *ctx);
+
+#endif /* _HOST_PLIC_H */
@@ -0,0 +1,188 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "image_pyramid.h"
+
+/* Odd sizes, so levels round down and the last sample sits against the edge */
+#define SRC_W 203
+#define SRC_H 151
+/* Bilinear levels are weighted in 8 bits, the reference in floating point */
+#define BILINEAR_TOLERANCE 1
+
+static uint8_t source[SRC_W * SRC_H * 3];
+
+/*
+ * Ramps in a different direction in every plane, plus a little texture. The
+ * steps between neighbours stay small, where 8-bit weights are within one
+ * level of exact.
+ */
+static void fill_source(uint32_t seed)
+{
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        for (uint32_t y = 0; y < SRC_H; y++)
+        {
+            for (uint32_t x = 0; x < SRC_W; x++)
+            {
+                uint32_t u = k == 1 ? SRC_W - 1 - x : x, v = k == 2 ? SRC_H - 1 - y : y;
+
+                source[(k * SRC_H + y) * SRC_W + x] =
+                    (uint8_t)(u * 160 / SRC_W + v * 70 / SRC_H + (x * 7 + y * 13 + seed) % 23);
+            }
+        }
+    }
+}
+
+static uint8_t ref_box2(const image_t *src, uint32_t k, uint32_t x, uint32_t y)
+{
+    const uint8_t *p = src->addr + (k * src->height + 2 * y) * src->width + 2 * x;
+
+    return (p[0] + p[1] + p[src->width] + p[src->width + 1] + 2) / 4;
+}
+
+/* Centre-aligned sampling, clamped at the image edges */
+static uint8_t ref_bilinear(const image_t *src, const image_t *dst, uint32_t k, uint32_t x, uint32_t y)
+{
+    const uint8_t *plane = src->addr + k * src->width * src->height;
+    double sx = (x + 0.5) * src->width / dst->width - 0.5;
+    double sy = (y + 0.5) * src->height / dst->height - 0.5;
+    uint32_t x0, y0, x1, y1;
+    double fx, fy, top, bottom;
+
+    sx = sx < 0 ? 0 : sx;
+    sy = sy < 0 ? 0 : sy;
+    x0 = (uint32_t)sx;
+    y0 = (uint32_t)sy;
+    fx = sx - x0;
+    fy = sy - y0;
+    x1 = x0 + 1 < src->width ? x0 + 1 : x0;
+    y1 = y0 + 1 < src->height ? y0 + 1 : y0;
+    top = plane[y0 * src->width + x0] * (1 - fx) + plane[y0 * src->width + x1] * fx;
+    bottom = plane[y1 * src->width + x0] * (1 - fx) + plane[y1 * src->width + x1] * fx;
+    return (uint8_t)lround(top * (1 - fy) + bottom * fy);
+}
+
+/* Each level against a reference made from the level above it, silently when name is NULL */
+static int check_level(const char *name, image_pyramid_t *pyramid, uint8_t level)
+{
+    const image_t *src = &pyramid->level[level - 1];
+    const image_t *dst = &pyramid->level[level];
+    int box2 = pyramid->ratio == IMAGE_PYRAMID_RATIO_HALF;
+    int tolerance = box2 ? 0 : BILINEAR_TOLERANCE;
+
+    for (uint32_t k = 0; k < dst->pixel; k++)
+    {
+        for (uint32_t y = 0; y < dst->height; y++)
+        {
+            for (uint32_t x = 0; x < dst->width; x++)
+            {
+                int want = box2 ? ref_box2(src, k, x, y) : ref_bilinear(src, dst, k, x, y);
+                int got = dst->addr[(k * dst->height + y) * dst->width + x];
+
+                if (abs(got - want) > tolerance)
+                {
+                    if (name == NULL)
+                        return 1;
+                    printf("FAIL %s level %u (%ux%u) plane %u at (%u,%u): %d, expected %d\n", name, level, dst->width,
+                           dst->height, k, x, y, got, want);
+                    return 1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static uint8_t expected_levels(uint16_t ratio)
+{
+    uint32_t w = SRC_W, h = SRC_H;
+    uint8_t levels = 1;
+
+    for (; levels < IMAGE_PYRAMID_MAX_LEVELS; levels++)
+    {
+        w = (w * ratio) >> 8;
+        h = (h * ratio) >> 8;
+        if (w < IMAGE_PYRAMID_MIN_SIZE || h < IMAGE_PYRAMID_MIN_SIZE)
+            break;
+    }
+    return levels;
+}
+
+static int run(const char *name, uint16_t ratio)
+{
+    image_t image = {.addr = source, .width = SRC_W, .height = SRC_H, .pixel = 3};
+    image_pyramid_t pyramid;
+    uint8_t top;
+    int failed = 0;
+
+    fill_source(0);
+    if (image_pyramid_init(&pyramid, &image, IMAGE_PYRAMID_MAX_LEVELS, ratio) != 0)
+    {
+        printf("FAIL %s: init\n", name);
+        return 1;
+    }
+    top = pyramid.levels - 1;
+    if (pyramid.levels != expected_levels(ratio) || pyramid.levels < 3 || pyramid.ready != 1)
+    {
+        printf("FAIL %s: %u levels, ready %02x\n", name, pyramid.levels, pyramid.ready);
+        image_pyramid_deinit(&pyramid);
+        return 1;
+    }
+
+    /* Asking for a level builds it and every level above it, nothing below */
+    if (image_pyramid_get(&pyramid, 2) != &pyramid.level[2] || pyramid.ready != 0x07)
+    {
+        printf("FAIL %s: ready %02x after level 2\n", name, pyramid.ready);
+        failed = 1;
+    }
+    failed |= check_level(name, &pyramid, 1);
+    failed |= check_level(name, &pyramid, 2);
+
+    /* Built levels are kept until invalidated, even when the source changes */
+    fill_source(5);
+    image_pyramid_get(&pyramid, 1);
+    if (pyramid.ready != 0x07 || !check_level(NULL, &pyramid, 1))
+    {
+        printf("FAIL %s: level 1 rebuilt before invalidate\n", name);
+        failed = 1;
+    }
+
+    /* After invalidating, the top level is built from the new source all the way down */
+    image_pyramid_invalidate(&pyramid);
+    if (image_pyramid_get(&pyramid, top) != &pyramid.level[top] || pyramid.ready != (1 << pyramid.levels) - 1)
+    {
+        printf("FAIL %s: ready %02x after level %u\n", name, pyramid.ready, top);
+        failed = 1;
+    }
+    for (uint8_t n = 1; n <= top; n++)
+        failed |= check_level(name, &pyramid, n);
+    if (image_pyramid_get(&pyramid, pyramid.levels) != NULL)
+    {
+        printf("FAIL %s: level %u past the last one\n", name, pyramid.levels);
+        failed = 1;
+    }
+
+    printf("%-8s %u levels, smallest %ux%u %s\n", name, pyramid.levels, pyramid.level[top].width,
+           pyramid.level[top].height, failed ? "FAIL" : "ok");
+    image_pyramid_deinit(&pyramid);
+    return failed;
+}
+
+int main(void)
+{
+    image_t image = {.addr = source, .width = SRC_W, .height = SRC_H, .pixel = 3};
+    image_pyramid_t pyramid;
+    int failed = 0;
+
+    failed |= run("box2", IMAGE_PYRAMID_RATIO_HALF);
+    /* About 1/sqrt(2), and a shallow 0.85 */
+    failed |= run("bilinear", 181);
+    failed |= run("shallow", 218);
+
+    if (image_pyramid_init(&pyramid, &image, 4, 0) == 0 || image_pyramid_init(&pyramid, &image, 4, 256) == 0)
+    {
+        printf("FAIL ratios 0 and 256 accepted\n");
+        failed = 1;
+    }
+    return failed;
+}
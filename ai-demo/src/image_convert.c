@@ -0,0 +1,184 @@
+#include "image_convert.h"
+
+#define LANE16_LO 0x0000FFFF0000FFFFULL
+#define LANE8_LO  0x00FF00FF00FF00FFULL
+#define LANE16(x) ((x) * 0x0001000100010001ULL)
+
+/* Pixel i of a gram buffer lives in the other halfword of its 32-bit word */
+#define GRAM_PIXEL(gram, i) (((const uint16_t *)(gram))[(i) ^ 1])
+
+/* Swap the two halfwords of each 32-bit word: gram order <-> pixel order */
+static inline uint64_t swap_halves(uint64_t v)
+{
+    return ((v >> 16) & LANE16_LO) | ((v & LANE16_LO) << 16);
+}
+
+/* Four 16-bit lanes holding bytes -> four packed bytes, lane 0 first */
+static inline uint32_t pack_lanes(uint64_t v)
+{
+    v = (v | (v >> 8)) & LANE16_LO;
+    return (uint32_t)(v | (v >> 16));
+}
+
+/* Four packed bytes -> four 16-bit lanes, byte 0 in lane 0 */
+static inline uint64_t unpack_lanes(uint32_t x)
+{
+    uint64_t v = x;
+
+    v = (v | (v << 16)) & LANE16_LO;
+    return (v | (v << 8)) & LANE8_LO;
+}
+
+/*
+ * 5/6-bit lanes -> 8-bit lanes. Right shifts pull bits in from the next lane,
+ * so the low part is masked back to its own lane.
+ */
+static inline uint64_t expand5(uint64_t v)
+{
+    return (v << 3) | ((v >> 2) & LANE16(0x07));
+}
+
+static inline uint64_t expand6(uint64_t v)
+{
+    return (v << 2) | ((v >> 4) & LANE16(0x03));
+}
+
+static inline int is_aligned4(const void *p)
+{
+    return ((uintptr_t)p & 3) == 0;
+}
+
+static inline int is_aligned8(const void *p)
+{
+    return ((uintptr_t)p & 7) == 0;
+}
+
+void image_rgb565_to_planar(const uint32_t *gram, image_t *image_dst)
+{
+    uint32_t pixels = image_dst->width * image_dst->height;
+    uint8_t *r = image_dst->addr;
+    uint8_t *g = r + pixels;
+    uint8_t *b = g + pixels;
+    uint32_t i = 0;
+
+    if (is_aligned8(gram) && is_aligned4(r) && is_aligned4(g) && is_aligned4(b))
+    {
+        const uint64_t *src = (const uint64_t *)gram;
+
+        for (; i + 4 <= pixels; i += 4)
+        {
+            uint64_t v = swap_halves(*src++);
+            uint64_t r5 = (v >> 11) & LANE16(0x1F);
+            uint64_t g6 = (v >> 5) & LANE16(0x3F);
+            uint64_t b5 = v & LANE16(0x1F);
+
+            /* Replicate the high bits into the low bits to reach full scale */
+            *(uint32_t *)(r + i) = pack_lanes(expand5(r5));
+            *(uint32_t *)(g + i) = pack_lanes(expand6(g6));
+            *(uint32_t *)(b + i) = pack_lanes(expand5(b5));
+        }
+    }
+    for (; i < pixels; i++)
+    {
+        uint16_t p = GRAM_PIXEL(gram, i);
+        uint8_t r5 = p >> 11, g6 = (p >> 5) & 0x3F, b5 = p & 0x1F;
+
+        r[i] = (r5 << 3) | (r5 >> 2);
+        g[i] = (g6 << 2) | (g6 >> 4);
+        b[i] = (b5 << 3) | (b5 >> 2);
+    }
+}
+
+void image_planar_to_rgb565(image_t *image_src, uint32_t *gram)
+{
+    uint32_t pixels = image_src->width * image_src->height;
+    const uint8_t *r = image_src->addr;
+    const uint8_t *g = r + pixels;
+    const uint8_t *b = g + pixels;
+    uint32_t i = 0;
+
+    if (is_aligned8(gram) && is_aligned4(r) && is_aligned4(g) && is_aligned4(b))
+    {
+        uint64_t *dst = (uint64_t *)gram;
+
+        for (; i + 4 <= pixels; i += 4)
+        {
+            uint64_t r8 = unpack_lanes(*(const uint32_t *)(r + i));
+            uint64_t g8 = unpack_lanes(*(const uint32_t *)(g + i));
+            uint64_t b8 = unpack_lanes(*(const uint32_t *)(b + i));
+            uint64_t v = ((r8 & LANE16(0xF8)) << 8) | ((g8 & LANE16(0xFC)) << 3) | ((b8 >> 3) & LANE16(0x1F));
+
+            *dst++ = swap_halves(v);
+        }
+    }
+    for (; i < pixels; i++)
+        ((uint16_t *)gram)[i ^ 1] = ((r[i] & 0xF8) << 8) | ((g[i] & 0xFC) << 3) | (b[i] >> 3);
+}
+
+void image_rgb565_to_gray(const uint32_t *gram, uint8_t *gray, uint32_t pixels)
+{
+    uint32_t i = 0;
+
+    if (is_aligned8(gram) && is_aligned4(gray))
+    {
+        const uint64_t *src = (const uint64_t *)gram;
+
+        for (; i + 4 <= pixels; i += 4)
+        {
+            uint64_t v = swap_halves(*src++);
+            uint64_t r5 = (v >> 11) & LANE16(0x1F);
+            uint64_t g6 = (v >> 5) & LANE16(0x3F);
+            uint64_t b5 = v & LANE16(0x1F);
+            uint64_t r8 = expand5(r5);
+            uint64_t g8 = expand6(g6);
+            uint64_t b8 = expand5(b5);
+
+            /* BT.601 weights summing to 256, so each lane stays below 0x10000 */
+            uint64_t y = (r8 * 77 + g8 * 150 + b8 * 29) >> 8;
+
+            *(uint32_t *)(gray + i) = pack_lanes(y & LANE16(0xFF));
+        }
+    }
+    for (; i < pixels; i++)
+    {
+        uint16_t p = GRAM_PIXEL(gram, i);
+        uint8_t r5 = p >> 11, g6 = (p >> 5) & 0x3F, b5 = p & 0x1F;
+        uint32_t r8 = (r5 << 3) | (r5 >> 2);
+        uint32_t g8 = (g6 << 2) | (g6 >> 4);
+        uint32_t b8 = (b5 << 3) | (b5 >> 2);
+
+        gray[i] = (r8 * 77 + g8 * 150 + b8 * 29) >> 8;
+    }
+}
+
+void image_planar_to_interleaved(image_t *image_src, uint8_t *rgb)
+{
+    uint32_t pixels = image_src->width * image_src->height;
+    const uint8_t *r = image_src->addr;
+    const uint8_t *g = r + pixels;
+    const uint8_t *b = g + pixels;
+    uint32_t i = 0;
+
+    if (is_aligned4(rgb) && is_aligned4(r) && is_aligned4(g) && is_aligned4(b))
+    {
+        uint32_t *dst = (uint32_t *)rgb;
+
+        for (; i + 4 <= pixels; i += 4)
+        {
+            uint32_t r4 = *(const uint32_t *)(r + i);
+            uint32_t g4 = *(const uint32_t *)(g + i);
+            uint32_t b4 = *(const uint32_t *)(b + i);
+
+            /* r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3 */
+            *dst++ = (r4 & 0xFF) | (g4 & 0xFF) << 8 | (b4 & 0xFF) << 16 | (r4 & 0xFF00) << 16;
+            *dst++ = (g4 >> 8 & 0xFF) | (b4 & 0xFF00) | (r4 & 0xFF0000) | (g4 & 0xFF0000) << 8;
+            *dst++ = (b4 >> 16 & 0xFF) | (r4 >> 16 & 0xFF00) | (g4 >> 8 & 0xFF0000) | (b4 & 0xFF000000);
+        }
+    }
+    for (; i < pixels; i++)
+    {
+        rgb[i * 3 + 0] = r[i];
+        rgb[i * 3 + 1] = g[i];
+        rgb[i * 3 + 2] = b[i];
+    }
+}
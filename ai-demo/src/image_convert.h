@@ -0,0 +1,24 @@
+#ifndef _IMAGE_CONVERT_H
+#define _IMAGE_CONVERT_H
+
+#include <stdint.h>
+#include "image_process.h"
+
+/*
+ * Pixel format conversions between the two DVP outputs.
+ *
+ * "gram" buffers hold RGB565 in the order the LCD expects and the DVP display
+ * output produces: each 32-bit word carries two pixels with the left one in the
+ * upper halfword. Planar images are image_t with pixel == 3 (R, G, B planes).
+ *
+ * The kernels work on four pixels per 64-bit word when the gram buffer is
+ * 8-byte and the byte planes 4-byte aligned, and fall back to a per-pixel loop
+ * for the tail or unaligned input.
+ */
+
+void image_rgb565_to_planar(const uint32_t *gram, image_t *image_dst);
+void image_planar_to_rgb565(image_t *image_src, uint32_t *gram);
+void image_rgb565_to_gray(const uint32_t *gram, uint8_t *gray, uint32_t pixels);
+void image_planar_to_interleaved(image_t *image_src, uint8_t *rgb);
+
+#endif /* _IMAGE_CONVERT_H */
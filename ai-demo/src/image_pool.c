@@ -0,0 +1,113 @@
+#include <stddef.h>
+#include "encoding.h"
+#include "image_pool.h"
+
+typedef struct _pool_block
+{
+    struct _pool_block *next;
+    uint32_t size_class;
+    volatile uint32_t refcount;
+} __attribute__((aligned(IMAGE_POOL_ALIGN))) pool_block_t;
+
+/* Classes cover the demo's 128x128, 224x224 and 320x240 RGB888/RGB565 frames */
+static const uint32_t size_classes[] = {
+    4 * 1024, 16 * 1024, 64 * 1024, 96 * 1024, 160 * 1024, 240 * 1024, 320 * 1024,
+};
+#define SIZE_CLASS_NUM (sizeof(size_classes) / sizeof(size_classes[0]))
+
+static uint8_t pool_memory[IMAGE_POOL_SIZE] __attribute__((aligned(IMAGE_POOL_ALIGN)));
+static uint32_t pool_top;
+static pool_block_t *free_list[SIZE_CLASS_NUM];
+static image_pool_stats_t pool_stats;
+
+static unsigned long pool_lock(void)
+{
+    return clear_csr(mstatus, MSTATUS_MIE) & MSTATUS_MIE;
+}
+
+static void pool_unlock(unsigned long irq_state)
+{
+    set_csr(mstatus, irq_state);
+}
+
+static pool_block_t *pool_block_of(void *buf)
+{
+    return (pool_block_t *)buf - 1;
+}
+
+void *image_pool_alloc(uint32_t size)
+{
+    pool_block_t *block = NULL;
+    uint32_t cls, bytes;
+    unsigned long irq_state;
+
+    for (cls = 0; cls < SIZE_CLASS_NUM; cls++)
+        if (size <= size_classes[cls])
+            break;
+    if (cls == SIZE_CLASS_NUM)
+        return NULL;
+
+    irq_state = pool_lock();
+    if (free_list[cls])
+    {
+        block = free_list[cls];
+        free_list[cls] = block->next;
+        pool_stats.reuse_count++;
+    }
+    else
+    {
+        bytes = sizeof(pool_block_t) + size_classes[cls];
+        if (pool_top + bytes <= IMAGE_POOL_SIZE)
+        {
+            block = (pool_block_t *)(pool_memory + pool_top);
+            block->size_class = cls;
+            pool_top += bytes;
+            pool_stats.reserved = pool_top;
+        }
+    }
+    if (block)
+    {
+        block->next = NULL;
+        block->refcount = 1;
+        pool_stats.alloc_count++;
+        pool_stats.used += size_classes[cls];
+        if (pool_stats.used > pool_stats.high_water)
+            pool_stats.high_water = pool_stats.used;
+    }
+    pool_unlock(irq_state);
+
+    return block ? block + 1 : NULL;
+}
+
+void image_pool_retain(void *buf)
+{
+    if (buf)
+        __sync_fetch_and_add(&pool_block_of(buf)->refcount, 1);
+}
+
+void image_pool_release(void *buf)
+{
+    pool_block_t *block;
+    unsigned long irq_state;
+
+    if (buf == NULL)
+        return;
+
+    block = pool_block_of(buf);
+    if (__sync_sub_and_fetch(&block->refcount, 1) != 0)
+        return;
+
+    irq_state = pool_lock();
+    block->next = free_list[block->size_class];
+    free_list[block->size_class] = block;
+    pool_stats.used -= size_classes[block->size_class];
+    pool_unlock(irq_state);
+}
+
+void image_pool_get_stats(image_pool_stats_t *stats)
+{
+    unsigned long irq_state = pool_lock();
+
+    *stats = pool_stats;
+    pool_unlock(irq_state);
+}
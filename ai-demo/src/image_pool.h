@@ -0,0 +1,30 @@
+#ifndef _IMAGE_POOL_H
+#define _IMAGE_POOL_H
+
+#include <stdint.h>
+
+/* Static SRAM reserved for image buffers */
+#define IMAGE_POOL_SIZE  (1024 * 1024)
+/* Every buffer starts on a cache line, so KPU upload and DMA take the fast path */
+#define IMAGE_POOL_ALIGN 64
+
+typedef struct
+{
+    uint32_t used;
+    uint32_t high_water;
+    uint32_t reserved;
+    uint32_t alloc_count;
+    uint32_t reuse_count;
+} image_pool_stats_t;
+
+/*
+ * Buffers are rounded up to a fixed size class and returned with one
+ * reference. A released buffer goes back on its class free list and is handed
+ * out again to the next request of that class instead of returning to the heap.
+ */
+void *image_pool_alloc(uint32_t size);
+void image_pool_retain(void *buf);
+void image_pool_release(void *buf);
+void image_pool_get_stats(image_pool_stats_t *stats);
+
+#endif /* _IMAGE_POOL_H */
@@ -17,51 +17,179 @@
 #include <string.h>
 #include <math.h>
 #include "image_process.h"
+#include "image_pool.h"
 
 int image_init(image_t *image)
 {
-    image->addr = malloc(image->width * image->height * image->pixel);
+    image->addr = image_pool_alloc(image->width * image->height * image->pixel);
     if (image->addr == NULL)
         return -1;
     return 0;
 }
 
+void image_retain(image_t *image)
+{
+    image_pool_retain(image->addr);
+}
+
 void image_deinit(image_t *image)
 {
-    free(image->addr);
+    image_pool_release(image->addr);
+}
+
+static void image_plane_offsets(image_t *image, uint8_t *plane[3])
+{
+    uint32_t plane_size = image->width * image->height;
+
+    plane[0] = image->addr;
+    plane[1] = plane[0] + plane_size;
+    plane[2] = plane[1] + plane_size;
 }
 
 void image_crop(image_t *image_src, image_t *image_dst, uint16_t x_offset, uint16_t y_offset)
 {
-    uint8_t *src, *r_src, *g_src, *b_src, *dst, *r_dst, *g_dst, *b_dst;
-    uint16_t w_src, h_src, w_dst, h_dst;
+    uint8_t *src[3], *dst[3];
+    uint16_t w_src, w_dst, h_dst;
 
-    src = image_src->addr;
     w_src = image_src->width;
-    h_src = image_src->height;
-    dst = image_dst->addr;
     w_dst = image_dst->width;
     h_dst = image_dst->height;
+    image_plane_offsets(image_src, src);
+    image_plane_offsets(image_dst, dst);
 
-    r_src = src + y_offset * w_src + x_offset;
-    g_src = r_src + w_src * h_src;
-    b_src = g_src + w_src * h_src;
-    r_dst = dst;
-    g_dst = r_dst + w_dst * h_dst;
-    b_dst = g_dst + w_dst * h_dst;
+    for (uint16_t k = 0; k < 3; k++)
+    {
+        uint8_t *s = src[k] + y_offset * w_src + x_offset;
+        uint8_t *d = dst[k];
 
-    for (uint16_t y = 0; y < h_dst; y++)
+        /* A full-width crop is one contiguous block per plane */
+        if (w_dst == w_src)
+        {
+            memcpy(d, s, w_dst * h_dst);
+            continue;
+        }
+        for (uint16_t y = 0; y < h_dst; y++)
+        {
+            memcpy(d, s, w_dst);
+            s += w_src;
+            d += w_dst;
+        }
+    }
+}
+
+static struct
+{
+    dmac_channel_number_t channel;
+    uint8_t *src[3];
+    uint8_t *dst[3];
+    /* 32-bit, since a full-width crop is moved as one row of w * h bytes */
+    uint32_t w_src;
+    uint32_t w_dst;
+    uint16_t h_dst;
+    uint16_t plane;
+    uint16_t row;
+    dmac_transfer_width_t trans_width;
+    uint32_t trans_count;
+    plic_irq_callback_t callback;
+    void *ctx;
+    volatile uint8_t busy;
+} crop_dma;
+
+static void image_crop_dma_start_row(void)
+{
+    const uint8_t *s = crop_dma.src[crop_dma.plane] + crop_dma.row * crop_dma.w_src;
+    uint8_t *d = crop_dma.dst[crop_dma.plane] + crop_dma.row * crop_dma.w_dst;
+
+    dmac_set_single_mode(crop_dma.channel, s, d, DMAC_ADDR_INCREMENT, DMAC_ADDR_INCREMENT,
+                         DMAC_MSIZE_4, crop_dma.trans_width, crop_dma.trans_count);
+}
+
+static int image_crop_dma_irq(void *ctx)
+{
+    (void)ctx;
+    if (++crop_dma.row >= crop_dma.h_dst)
     {
-        for (uint16_t x = 0; x < w_dst; x++)
+        crop_dma.row = 0;
+        if (++crop_dma.plane >= 3)
         {
-            *r_dst++ = r_src[x];
-            *g_dst++ = g_src[x];
-            *b_dst++ = b_src[x];
+            dmac_irq_unregister(crop_dma.channel);
+            crop_dma.busy = 0;
+            if (crop_dma.callback)
+                crop_dma.callback(crop_dma.ctx);
+            return 0;
         }
-        r_src += w_src;
-        g_src += w_src;
-        b_src += w_src;
     }
+    image_crop_dma_start_row();
+    return 0;
+}
+
+int image_crop_async(image_t *image_src, image_t *image_dst, uint16_t x_offset, uint16_t y_offset,
+                     dmac_channel_number_t channel, plic_irq_callback_t callback, void *ctx)
+{
+    uint32_t row_bytes, align;
+
+    if (crop_dma.busy)
+        return -1;
+
+    if (image_dst->width * image_dst->height < IMAGE_CROP_DMA_THRESHOLD)
+    {
+        image_crop(image_src, image_dst, x_offset, y_offset);
+        if (callback)
+            callback(ctx);
+        return 0;
+    }
+
+    crop_dma.channel = channel;
+    crop_dma.w_src = image_src->width;
+    crop_dma.w_dst = image_dst->width;
+    crop_dma.h_dst = image_dst->height;
+    image_plane_offsets(image_src, crop_dma.src);
+    image_plane_offsets(image_dst, crop_dma.dst);
+    for (uint16_t k = 0; k < 3; k++)
+        crop_dma.src[k] += y_offset * crop_dma.w_src + x_offset;
+
+    /* A full-width crop is one contiguous block per plane */
+    if (crop_dma.w_dst == crop_dma.w_src)
+    {
+        crop_dma.w_dst *= crop_dma.h_dst;
+        crop_dma.w_src = crop_dma.w_dst;
+        crop_dma.h_dst = 1;
+    }
+
+    /* Use the widest beat every row start and length allows */
+    row_bytes = crop_dma.w_dst;
+    align = row_bytes | crop_dma.w_src;
+    for (uint16_t k = 0; k < 3; k++)
+        align |= (uintptr_t)crop_dma.src[k] | (uintptr_t)crop_dma.dst[k];
+    if ((align & 3) == 0)
+    {
+        crop_dma.trans_width = DMAC_TRANS_WIDTH_32;
+        crop_dma.trans_count = row_bytes / 4;
+    }
+    else if ((align & 1) == 0)
+    {
+        crop_dma.trans_width = DMAC_TRANS_WIDTH_16;
+        crop_dma.trans_count = row_bytes / 2;
+    }
+    else
+    {
+        crop_dma.trans_width = DMAC_TRANS_WIDTH_8;
+        crop_dma.trans_count = row_bytes;
+    }
+
+    crop_dma.plane = 0;
+    crop_dma.row = 0;
+    crop_dma.callback = callback;
+    crop_dma.ctx = ctx;
+    crop_dma.busy = 1;
+    dmac_irq_register(channel, image_crop_dma_irq, NULL, 1);
+    image_crop_dma_start_row();
+    return 0;
+}
+
+int image_crop_busy(void)
+{
+    return crop_dma.busy;
 }
 
 void image_resize(image_t *image_src, image_t *image_dst)
@@ -165,8 +293,8 @@ void image_umeyama(float *src, float *dst)
     dst_mean[0] /= SRC_NUM;
     dst_mean[1] /= SRC_NUM;
 
-    float src_demean[SRC_NUM][2] = {0.0};
-    float dst_demean[SRC_NUM][2] = {0.0};
+    float src_demean[SRC_NUM][2] = {{0.0}};
+    float dst_demean[SRC_NUM][2] = {{0.0}};
 
     for(i=0; i<SRC_NUM; i++)
     {
@@ -176,7 +304,7 @@ void image_umeyama(float *src, float *dst)
         dst_demean[i][1] = src[2*i+1] - dst_mean[1];
     }
 
-    float A[SRC_DIM][SRC_DIM] = {0.0};
+    float A[SRC_DIM][SRC_DIM] = {{0.0}};
     for(i=0; i<SRC_DIM; i++)
     {
         for(k=0; k<SRC_DIM; k++)
@@ -189,11 +317,6 @@ void image_umeyama(float *src, float *dst)
         }
     }
 
-    float d[SRC_DIM] = {1, 1};
-    float det_A = A[0][0]*A[1][1] - A[1][0]*A[1][0];
-    if(det_A < 0)
-        d[SRC_DIM-1] = -1;
-
     float (*T)[SRC_DIM+1] = (float (*)[SRC_DIM+1])dst;
     T[0][0] = 1;
     T[0][1] = 0;
@@ -205,16 +328,11 @@ void image_umeyama(float *src, float *dst)
     T[2][1] = 0;
     T[2][2] = 1;
 
-    float U[SRC_DIM][SRC_DIM] = {0};
+    float U[SRC_DIM][SRC_DIM] = {{0}};
     float S[SRC_DIM] = {0};
-    float V[SRC_DIM][SRC_DIM] = {0};
-    svd22(&A[0][0], &U[0][0], S, &V[0][0]);
+    float V[SRC_DIM][SRC_DIM] = {{0}};
+    svd22((const float *)A, (float *)U, S, (float *)V);
 
-    float diag_d[SRC_DIM][SRC_DIM] = 
-        {
-            {1.0, 0.0},
-            {0.0, 1.0}
-        };
     T[0][0] = U[0][0]*V[0][0] + U[0][1]*V[1][0];
     T[0][1] = U[0][0]*V[0][1] + U[0][1]*V[1][1];
     T[1][0] = U[1][0]*V[0][0] + U[1][1]*V[1][0];
@@ -247,55 +365,84 @@ void image_umeyama(float *src, float *dst)
     T[1][1] *= scale;
 }
 
-void image_similarity(image_t *image_src, image_t *image_dst, float *T)
+/* Fractional bits of the source coordinate accumulators in image_warp_affine */
+#define WARP_SHIFT 16
+
+static void image_warp_affine(image_t *image_src, image_t *image_dst, float *T)
 {
-    //相似变换
     int width = image_src->width;
     int height = image_src->height;
     int channels = image_src->pixel;
-    int step = width;
-	int color_step = width * height;
-    int sim_step;
-    int i, j, k;
-	
-    //初始化处理后图片的信息
-    image_dst->pixel = channels;
-    image_dst->width = 128;
-    image_dst->height = 128;
-	int sim_color_step = image_dst->width * image_dst->height;
-    sim_step = image_dst->width;
-    image_dst->addr = malloc(image_dst->width*image_dst->height*image_dst->pixel);
+    int color_step = width * height;
+    int sim_color_step = image_dst->width * image_dst->height;
+    float (*TT)[3] = (float (*)[3])T;
+    uint8_t *dst = image_dst->addr;
 
-    //初始化图像
-    memset(image_dst->addr, 0, image_dst->width*image_dst->height*image_dst->pixel);
+    /* Source coordinates advance by a constant delta per output pixel and row */
+    int32_t dx_col = (int32_t)lroundf(TT[0][0] * (1 << WARP_SHIFT));
+    int32_t dy_col = (int32_t)lroundf(TT[1][0] * (1 << WARP_SHIFT));
+    int32_t dx_row = (int32_t)lroundf(TT[0][1] * (1 << WARP_SHIFT));
+    int32_t dy_row = (int32_t)lroundf(TT[1][1] * (1 << WARP_SHIFT));
+    int32_t x_row = (int32_t)lroundf(TT[0][2] * (1 << WARP_SHIFT));
+    int32_t y_row = (int32_t)lroundf(TT[1][2] * (1 << WARP_SHIFT));
 
-    int pre_x, pre_y, after_x, after_y;//缩放前对应的像素点坐标
-    int x, y;
-    unsigned short color[2][2];
-    float (*TT)[3] = (float (*)[3])T;
-    for(i = 0;i < image_dst->height;i++)
+    for (int i = 0; i < image_dst->height; i++)
     {
-        for(j = 0;j < image_dst->width;j++)
+        int32_t sx = x_row;
+        int32_t sy = y_row;
+
+        for (int j = 0; j < image_dst->width; j++, sx += dx_col, sy += dy_col)
         {
-            pre_x = (int)(TT[0][0] * (j << 8 ) + TT[0][1] * (i << 8 ) + TT[0][2]*(1 << 8 ));
-            pre_y = (int)(TT[1][0] * (j << 8 ) + TT[1][1] * (i << 8 ) + TT[1][2]*(1 << 8 ));
-
-            y = pre_y & 0xFF;
-            x = pre_x & 0xFF;
-            pre_x >>= 8;
-            pre_y >>= 8;
-            if(pre_x<0 || pre_x > (width-1) || pre_y<0 || pre_y>(height-1))
-				    continue;
-            for(k=0; k<channels; k++)
+            int pre_x = sx >> WARP_SHIFT;
+            int pre_y = sy >> WARP_SHIFT;
+
+            if (pre_x < 0 || pre_x > (width - 1) || pre_y < 0 || pre_y > (height - 1))
+                continue;
+
+            /* 8-bit bilinear weights, neighbours clamped at the right/bottom edge */
+            uint32_t x = (sx >> (WARP_SHIFT - 8)) & 0xFF;
+            uint32_t y = (sy >> (WARP_SHIFT - 8)) & 0xFF;
+            uint32_t w00 = (0x100 - x) * (0x100 - y);
+            uint32_t w10 = x * (0x100 - y);
+            uint32_t w01 = (0x100 - x) * y;
+            uint32_t w11 = x * y;
+            int right = pre_x < width - 1 ? 1 : 0;
+            int down = pre_y < height - 1 ? width : 0;
+            const uint8_t *p = image_src->addr + pre_y * width + pre_x;
+            uint8_t *q = dst + i * image_dst->width + j;
+
+            for (int k = 0; k < channels; k++)
             {
-                color[0][0] = image_src->addr[pre_y*step + pre_x + k * color_step];
-                color[1][0] = image_src->addr[pre_y*step + (pre_x + 1) + k * color_step];
-                color[0][1] = image_src->addr[(pre_y + 1)*step + pre_x + k * color_step];
-                color[1][1] = image_src->addr[(pre_y + 1)*step + (pre_x + 1) + k * color_step];
-                int final = (0x100 - x)*(0x100 - y)*color[0][0] + x * (0x100 - y)*color[1][0] + (0x100 - x)*y*color[0][1] + x * y*color[1][1];
-                final = final >> 16;
-                image_dst->addr[i * sim_step + j + k*sim_color_step] = final;
+                *q = (w00 * p[0] + w10 * p[right] + w01 * p[down] + w11 * p[down + right]) >> 16;
+                p += color_step;
+                q += sim_color_step;
             }
         }
+        x_row += dx_row;
+        y_row += dy_row;
+    }
+}
+
+void image_similarity(image_t *image_src, image_t *image_dst, float *T)
+{
+    //初始化处理后图片的信息
+    image_dst->pixel = image_src->pixel;
+    image_dst->width = 128;
+    image_dst->height = 128;
+    image_init(image_dst);
+
+    //初始化图像
+    memset(image_dst->addr, 0, image_dst->width * image_dst->height * image_dst->pixel);
+
+    image_warp_affine(image_src, image_dst, T);
+}
+
+void image_similarity_batch(image_t *image_src, image_t *image_dst, float *T, uint16_t count)
+{
+    for (uint16_t n = 0; n < count; n++)
+    {
+        image_dst[n].pixel = image_src->pixel;
+        memset(image_dst[n].addr, 0, image_dst[n].width * image_dst[n].height * image_dst[n].pixel);
+        image_warp_affine(image_src, &image_dst[n], T + n * 9);
     }
 }
@@ -16,6 +16,11 @@
 #define _IMAGE_PROCESS_H
 
 #include <stdint.h>
+#include "dmac.h"
+#include "plic.h"
+
+/* Crops smaller than this many pixels per plane are copied with memcpy */
+#define IMAGE_CROP_DMA_THRESHOLD (64 * 64)
 
 typedef struct
 {
@@ -27,11 +32,30 @@ typedef struct
 } image_t;
 
 
+/*
+ * Buffers come from the 64-byte aligned image pool. image_retain adds a
+ * reference for another pipeline stage; image_deinit drops one and the buffer
+ * is recycled once the last holder lets go.
+ */
 int image_init(image_t *image);
+void image_retain(image_t *image);
 void image_deinit(image_t *image);
 void image_crop(image_t *image_src, image_t *image_dst, uint16_t x_offset, uint16_t y_offset);
+/*
+ * Start a planar crop and return immediately. Large crops are moved row by row
+ * with memory-to-memory DMA on the given channel; callback runs in interrupt
+ * context when the last row lands. Returns -1 if a crop is already in flight.
+ */
+int image_crop_async(image_t *image_src, image_t *image_dst, uint16_t x_offset, uint16_t y_offset,
+                     dmac_channel_number_t channel, plic_irq_callback_t callback, void *ctx);
+int image_crop_busy(void);
 void image_resize(image_t *image_src, image_t *image_dst);
 void image_umeyama(float *src, float *dst);
 void image_similarity(image_t *image_src, image_t *image_dst, float *T);
+/*
+ * Align count faces from one frame. image_dst[n] must already be allocated with
+ * its width/height set; T holds count consecutive 3x3 matrices from image_umeyama.
+ */
+void image_similarity_batch(image_t *image_src, image_t *image_dst, float *T, uint16_t count);
 
 #endif /* _IMAGE_PROCESS_H */
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include "image_pyramid.h"
+
+#define ARENA_ALIGN 8
+
+static void image_downscale_box2(image_t *image_src, image_t *image_dst)
+{
+    uint32_t src_size = image_src->width * image_src->height;
+    uint32_t dst_size = image_dst->width * image_dst->height;
+    uint16_t w_src = image_src->width;
+
+    for (uint16_t k = 0; k < image_src->pixel; k++)
+    {
+        const uint8_t *src = image_src->addr + k * src_size;
+        uint8_t *dst = image_dst->addr + k * dst_size;
+
+        for (uint16_t y = 0; y < image_dst->height; y++)
+        {
+            const uint8_t *row0 = src + 2 * y * w_src;
+            const uint8_t *row1 = row0 + w_src;
+
+            for (uint16_t x = 0; x < image_dst->width; x++)
+            {
+                *dst++ = (row0[0] + row0[1] + row1[0] + row1[1] + 2) >> 2;
+                row0 += 2;
+                row1 += 2;
+            }
+        }
+    }
+}
+
+static void image_downscale_bilinear(image_t *image_src, image_t *image_dst)
+{
+    uint32_t src_size = image_src->width * image_src->height;
+    uint32_t dst_size = image_dst->width * image_dst->height;
+    uint16_t w_src = image_src->width;
+    uint16_t h_src = image_src->height;
+    /* Source step per destination pixel in 16.16, sampling at pixel centres */
+    uint32_t x_step = ((uint32_t)image_src->width << 16) / image_dst->width;
+    uint32_t y_step = ((uint32_t)image_src->height << 16) / image_dst->height;
+
+    for (uint16_t k = 0; k < image_src->pixel; k++)
+    {
+        const uint8_t *src = image_src->addr + k * src_size;
+        uint8_t *dst = image_dst->addr + k * dst_size;
+        int32_t sy = (int32_t)(y_step >> 1) - (1 << 15);
+
+        for (uint16_t y = 0; y < image_dst->height; y++, sy += y_step)
+        {
+            int32_t y0 = sy < 0 ? 0 : sy >> 16;
+            uint32_t fy = sy < 0 ? 0 : (sy >> 8) & 0xFF;
+            const uint8_t *row0 = src + y0 * w_src;
+            const uint8_t *row1 = y0 < h_src - 1 ? row0 + w_src : row0;
+            int32_t sx = (int32_t)(x_step >> 1) - (1 << 15);
+
+            for (uint16_t x = 0; x < image_dst->width; x++, sx += x_step)
+            {
+                int32_t x0 = sx < 0 ? 0 : sx >> 16;
+                uint32_t fx = sx < 0 ? 0 : (sx >> 8) & 0xFF;
+                int32_t x1 = x0 < w_src - 1 ? x0 + 1 : x0;
+                uint32_t top = row0[x0] * (0x100 - fx) + row0[x1] * fx;
+                uint32_t bottom = row1[x0] * (0x100 - fx) + row1[x1] * fx;
+
+                *dst++ = (top * (0x100 - fy) + bottom * fy + 0x8000) >> 16;
+            }
+        }
+    }
+}
+
+int image_pyramid_init(image_pyramid_t *pyramid, image_t *image_src, uint8_t levels, uint16_t ratio)
+{
+    uint32_t offset[IMAGE_PYRAMID_MAX_LEVELS];
+    uint32_t arena_size = 0;
+    uint8_t n;
+
+    if (levels > IMAGE_PYRAMID_MAX_LEVELS)
+        levels = IMAGE_PYRAMID_MAX_LEVELS;
+    if (ratio == 0 || ratio >= 256)
+        return -1;
+
+    pyramid->level[0] = *image_src;
+    pyramid->ratio = ratio;
+    for (n = 1; n < levels; n++)
+    {
+        image_t *prev = &pyramid->level[n - 1];
+        image_t *cur = &pyramid->level[n];
+
+        cur->width = (prev->width * ratio) >> 8;
+        cur->height = (prev->height * ratio) >> 8;
+        cur->pixel = prev->pixel;
+        cur->format = prev->format;
+        cur->addr = NULL;
+        if (cur->width < IMAGE_PYRAMID_MIN_SIZE || cur->height < IMAGE_PYRAMID_MIN_SIZE)
+            break;
+        offset[n] = arena_size;
+        arena_size += (cur->width * cur->height * cur->pixel + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    }
+    pyramid->levels = n;
+
+    pyramid->arena = NULL;
+    if (arena_size)
+    {
+        pyramid->arena = malloc(arena_size);
+        if (pyramid->arena == NULL)
+            return -1;
+    }
+    for (n = 1; n < pyramid->levels; n++)
+        pyramid->level[n].addr = pyramid->arena + offset[n];
+
+    image_pyramid_invalidate(pyramid);
+    return 0;
+}
+
+void image_pyramid_deinit(image_pyramid_t *pyramid)
+{
+    free(pyramid->arena);
+    pyramid->arena = NULL;
+    pyramid->levels = 0;
+    pyramid->ready = 0;
+}
+
+void image_pyramid_invalidate(image_pyramid_t *pyramid)
+{
+    /* Level 0 is the capture buffer itself and always up to date */
+    pyramid->ready = 1;
+}
+
+image_t *image_pyramid_get(image_pyramid_t *pyramid, uint8_t level)
+{
+    uint8_t n;
+
+    if (level >= pyramid->levels)
+        return NULL;
+
+    /* Find the nearest generated level and build downwards from it */
+    for (n = level; !(pyramid->ready & (1 << n)); n--)
+        ;
+    for (n++; n <= level; n++)
+    {
+        image_t *prev = &pyramid->level[n - 1];
+        image_t *cur = &pyramid->level[n];
+
+        if (pyramid->ratio == IMAGE_PYRAMID_RATIO_HALF)
+            image_downscale_box2(prev, cur);
+        else
+            image_downscale_bilinear(prev, cur);
+        pyramid->ready |= 1 << n;
+    }
+    return &pyramid->level[level];
+}
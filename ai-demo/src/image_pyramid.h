@@ -0,0 +1,32 @@
+#ifndef _IMAGE_PYRAMID_H
+#define _IMAGE_PYRAMID_H
+
+#include <stdint.h>
+#include "image_process.h"
+
+#define IMAGE_PYRAMID_MAX_LEVELS 8
+/* Levels narrower or shorter than this are not generated */
+#define IMAGE_PYRAMID_MIN_SIZE   16
+/* Per-level scale in Q8; 128 halves each dimension and uses a 2x2 box filter */
+#define IMAGE_PYRAMID_RATIO_HALF 128
+
+/*
+ * Multi-scale planar pyramid over a captured frame. Level 0 aliases the source
+ * image; the remaining levels live in one arena allocated at init and are only
+ * computed when first requested after image_pyramid_invalidate().
+ */
+typedef struct
+{
+    image_t level[IMAGE_PYRAMID_MAX_LEVELS];
+    uint8_t levels;
+    uint8_t ready;
+    uint16_t ratio;
+    uint8_t *arena;
+} image_pyramid_t;
+
+int image_pyramid_init(image_pyramid_t *pyramid, image_t *image_src, uint8_t levels, uint16_t ratio);
+void image_pyramid_deinit(image_pyramid_t *pyramid);
+void image_pyramid_invalidate(image_pyramid_t *pyramid);
+image_t *image_pyramid_get(image_pyramid_t *pyramid, uint8_t level);
+
+#endif /* _IMAGE_PYRAMID_H */
@@ -16,9 +16,10 @@
 #include <unistd.h>
 #include "lcd.h"
 #include "nt35310.h"
-#include "font.h"
+#include "lcd_font.h"
 
 static lcd_ctl_t lcd_ctl;
+static lcd_font_t lcd_font;
 
 void lcd_polling_enable(void)
 {
@@ -50,6 +51,9 @@ void lcd_init(void)
     /*display on*/
     tft_write_command(DISPALY_ON);
     lcd_polling_enable();
+
+    if (lcd_font.rows == NULL)
+        lcd_font_init(&lcd_font, 1);
 }
 
 void lcd_set_direction(lcd_dir_t dir)
@@ -128,87 +132,22 @@ void lcd_draw_string(uint16_t x, uint16_t y, char *str, uint16_t color)
 
 void lcd_ram_draw_string(char *str, uint32_t *ptr, uint16_t font_color, uint16_t bg_color)
 {
-    uint8_t i = 0;
-    uint8_t j = 0;
-    uint8_t data = 0;
-    uint8_t *pdata = NULL;
-    uint16_t width = 0;
-    uint32_t *pixel = NULL;
-
-    width = 4 * strlen(str);
-    while (*str)
-    {
-        pdata = (uint8_t *)&ascii0816[(*str) * 16];
-        for (i = 0; i < 16; i++)
-        {
-            data = *pdata++;
-            pixel = ptr + i * width;
-            for (j = 0; j < 4; j++)
-            {
-                switch (data >> 6)
-                {
-                    case 0:
-                        *pixel = ((uint32_t)bg_color << 16) | bg_color;
-                        break;
-                    case 1:
-                        *pixel = ((uint32_t)bg_color << 16) | font_color;
-                        break;
-                    case 2:
-                        *pixel = ((uint32_t)font_color << 16) | bg_color;
-                        break;
-                    case 3:
-                        *pixel = ((uint32_t)font_color << 16) | font_color;
-                        break;
-                    default:
-                        *pixel = 0;
-                        break;
-                }
-                data <<= 2;
-                pixel++;
-            }
-        }
-        str++;
-        ptr += 4;
-    }
+    lcd_font_draw_string_bg(&lcd_font, ptr, LCD_FONT_WIDTH * strlen(str), LCD_FONT_HEIGHT, 0, 0, str, font_color,
+                            bg_color);
 }
 
 void ram_draw_char(uint32_t *ptr, uint16_t x, uint16_t y, char c, uint16_t color)
 {
-    uint8_t i, j, data;
-    uint16_t *addr;
+    char str[2] = {c, 0};
 
-    for (i = 0; i < 16; i++)
-    {
-        addr = ((uint16_t *)ptr) + y * (lcd_ctl.width + 1) + x;
-        data = ascii0816[c * 16 + i];
-        for (j = 0; j < 8; j++)
-        {
-            if (data & 0x80)
-            {
-                if ((x + j) & 1)
-                    *(addr - 1) = color;
-                else
-                    *(addr + 1) = color;
-            }
-            data <<= 1;
-            addr++;
-        }
-        y++;
-    }
+    lcd_font_draw_string(&lcd_font, ptr, lcd_ctl.width + 1, lcd_ctl.height + 1, x, y, str, color);
 }
 
-
 void ram_draw_string(uint32_t *ptr, uint16_t x, uint16_t y, char *str, uint16_t color)
 {
-    while (*str)
-    {
-        ram_draw_char(ptr, x, y, *str, color);
-        str++;
-        x += 8;
-    }
+    lcd_font_draw_string(&lcd_font, ptr, lcd_ctl.width + 1, lcd_ctl.height + 1, x, y, str, color);
 }
 
-
 void lcd_clear(uint16_t color)
 {
     uint32_t data = ((uint32_t)color << 16) | (uint32_t)color;
@@ -0,0 +1,42 @@
+#ifndef _LCD_FONT_H
+#define _LCD_FONT_H
+
+#include <stdint.h>
+
+#define LCD_FONT_GLYPHS    256
+#define LCD_FONT_WIDTH     8
+#define LCD_FONT_HEIGHT    16
+/* Largest integer magnification; a scaled glyph row must fit 32 bits */
+#define LCD_FONT_MAX_SCALE 4
+
+/* 8x16 bitmap font, one byte per glyph row with the leftmost pixel in bit 7 */
+extern const uint8_t ascii0816[];
+
+/*
+ * Glyph atlas for drawing text into RGB565 framebuffers in GRAM order (two
+ * pixels per word, left pixel in the upper halfword).
+ *
+ * Every glyph row is expanded once at init to its scaled width, MSB first, so
+ * rendering never decodes font bits per pixel. At draw time pairs of atlas
+ * bits select a whole word mask and each glyph row is blended in with one
+ * read-modify-write per 32-bit word, for either pixel phase. Text is clipped
+ * against the framebuffer on all four edges; framebuffer widths must be even.
+ */
+typedef struct
+{
+    uint8_t scale;
+    uint8_t width;
+    uint8_t height;
+    uint32_t *rows;
+} lcd_font_t;
+
+int lcd_font_init(lcd_font_t *font, uint8_t scale);
+void lcd_font_deinit(lcd_font_t *font);
+/* Only the glyph pixels are written */
+void lcd_font_draw_string(const lcd_font_t *font, uint32_t *gram, uint16_t gram_width, uint16_t gram_height,
+                          int32_t x, int32_t y, const char *str, uint16_t font_color);
+/* Whole character cells are written, background included */
+void lcd_font_draw_string_bg(const lcd_font_t *font, uint32_t *gram, uint16_t gram_width, uint16_t gram_height,
+                             int32_t x, int32_t y, const char *str, uint16_t font_color, uint16_t bg_color);
+
+#endif /* _LCD_FONT_H */
@@ -33,6 +33,8 @@
 #endif
 
 #include "image_process.h"
+#include "image_convert.h"
+#include "image_pool.h"
 #include "gpiohs.h"
 #define INCBIN_STYLE INCBIN_STYLE_SNAKE
 #define INCBIN_PREFIX
@@ -40,6 +42,9 @@
 
 #define PROB_THRESH     (0.7f)
 
+/* Capture only the planar AI output and derive the LCD frame from it */
+#define DVP_SINGLE_OUTPUT 0
+
 #define PLL0_OUTPUT_FREQ 800000000UL
 #define PLL1_OUTPUT_FREQ 400000000UL
 
@@ -188,7 +193,7 @@ int main()
     dvp_set_xclk_rate(24000000);
     dvp_enable_burst();
     dvp_set_output_enable(0, 1);
-    dvp_set_output_enable(1, 1);
+    dvp_set_output_enable(1, !DVP_SINGLE_OUTPUT);
     dvp_set_image_format(DVP_CFG_RGB_FORMAT);
     dvp_set_image_size(320, 240);
 #if (BOARD_VERSION == BOARD_V1_2_LE)
@@ -210,8 +215,14 @@ int main()
     crop_image.width = 224;
     crop_image.height = 224;
     image_init(&crop_image);
+
+    image_pool_stats_t pool_stats;
+    image_pool_get_stats(&pool_stats);
+    printf("Image pool: %u bytes in use, %u bytes high water\n", pool_stats.used, pool_stats.high_water);
     dvp_set_ai_addr((uint32_t)kpu_image.addr, (uint32_t)(kpu_image.addr + 320 * 240), (uint32_t)(kpu_image.addr + 320 * 240 * 2));
+#if !DVP_SINGLE_OUTPUT
     dvp_set_display_addr((uint32_t)display_image.addr);
+#endif
     dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 0);
     dvp_disable_auto();
     /* DVP interrupt config */
@@ -247,7 +258,10 @@ int main()
         dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 1);
         while (g_dvp_finish_flag == 0)
             ;
-            
+#if DVP_SINGLE_OUTPUT
+        image_planar_to_rgb565(&kpu_image, (uint32_t *)display_image.addr);
+#endif
+
         image_crop(&kpu_image, &crop_image, 48, 8);
 
         g_ai_done_flag = 0;
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "dvp.h"
+#include "dvp_capture.h"
+#include "dvp_sim.h"
+#include "frame_stats.h"
+#include "lcd.h"
+#include "lcd_dirty.h"
+#include "lcd_sim.h"
+#include "motion_detect.h"
+
+#define FRAME_W 320
+#define FRAME_H 240
+#define SLOTS   3
+#define FRAMES  120
+#define CLIP    60
+/* Drops a run may have at the default rate and load, where the consumer keeps up */
+#define DEFAULT_MAX_DROPPED 2
+
+static motion_detect_t motion;
+static frame_stats_t stats;
+static lcd_dirty_t dirty;
+
+/* A square crossing a still checkerboard, roughly what lcd_bench renders */
+static uint8_t *make_clip(void)
+{
+    uint8_t *clip = malloc((size_t)CLIP * FRAME_W * FRAME_H * 3);
+    uint8_t *p = clip;
+
+    if (!clip)
+        return NULL;
+    for (uint32_t n = 0; n < CLIP; n++)
+    {
+        for (uint32_t y = 0; y < FRAME_H; y++)
+        {
+            for (uint32_t x = 0; x < FRAME_W; x++, p += 3)
+            {
+                uint8_t level = (x / 40 + y / 40) & 1 ? 96 : 32;
+
+                p[0] = p[1] = p[2] = level;
+                if (x >= 40 + 4 * n && x < 100 + 4 * n && y >= 80 && y < 140)
+                {
+                    p[0] = 200;
+                    p[1] = (uint8_t)(x + n);
+                    p[2] = 64;
+                }
+            }
+        }
+    }
+    return clip;
+}
+
+static uint64_t host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* FNV-1a over the last frame shown, the same on every run */
+static uint32_t checksum(const uint8_t *data, uint32_t size)
+{
+    uint32_t h = 2166136261U;
+
+    for (uint32_t i = 0; i < size; i++)
+        h = (h ^ data[i]) * 16777619U;
+    return h;
+}
+
+/* The panel shows the frame wherever the flush sent it, which after a diff is everywhere */
+static int check_panel(const char *name, const dvp_frame_t *frame)
+{
+    const uint16_t *gram = (const uint16_t *)frame->display.addr;
+
+    lcd_wait_idle();
+    for (uint32_t y = 0; y < FRAME_H; y++)
+    {
+        for (uint32_t x = 0; x < FRAME_W; x++)
+        {
+            uint16_t want = gram[(y * FRAME_W + x) ^ 1];
+            uint16_t got = lcd_sim_get_pixel(x, y);
+
+            if (got != want)
+            {
+                printf("FAIL %s: panel at (%u,%u) %04x, expected %04x\n", name, x, y, got, want);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Consume frames the way main does: motion and exposure statistics, then
+ * the frame to the panel. The consumer's time on the simulated clock is its
+ * panel transfer plus work_us, so frame drops and latencies depend only on
+ * the arguments; host_us is what the processing really took here. Fails on
+ * torn frames, on more than max_dropped drops, on frames lost without being
+ * counted, and when the panel does not end up showing the last frame.
+ */
+static int run(const char *name, dvp_capture_format_t format, uint32_t work_us, uint32_t max_dropped)
+{
+    dvp_capture_stats_t capture;
+    dvp_sim_stats_t sim;
+    lcd_sim_stats_t lcd;
+    uint64_t host = 0;
+    uint32_t shown = 0;
+    uint32_t sum = 0;
+    uint32_t pending;
+    int failed = 0;
+
+    dvp_capture_set_format(format, 1);
+    lcd_dirty_init(&dirty, NULL, FRAME_W, FRAME_H);
+    lcd_sim_reset_stats();
+    dvp_capture_reset_stats();
+    dvp_sim_reset_stats();
+    dvp_capture_start();
+    while (shown < FRAMES)
+    {
+        dvp_frame_t *frame = dvp_capture_acquire(0);
+        const image_t *input;
+        uint64_t spi_ns;
+        uint64_t start;
+
+        if (!frame)
+        {
+            dvp_sim_run_frames(1);
+            continue;
+        }
+
+        start = host_ns();
+        input = format == DVP_CAPTURE_LUMA ? dvp_capture_luma(frame) : &frame->ai;
+        motion_detect_run(&motion, input);
+        frame_stats_compute(&stats, input, 8);
+        lcd_dirty_set_gram(&dirty, (uint32_t *)frame->display.addr);
+        lcd_dirty_diff(&dirty);
+        lcd_dirty_flush(&dirty);
+        host += host_ns() - start;
+
+        lcd_sim_get_stats(&lcd);
+        spi_ns = lcd.spi_ns;
+        lcd_sim_reset_stats();
+        dvp_sim_advance(spi_ns + (uint64_t)work_us * 1000);
+        if (++shown == FRAMES)
+        {
+            sum = checksum(frame->display.addr, FRAME_W * FRAME_H * 2);
+            failed |= check_panel(name, frame);
+        }
+        dvp_capture_release(frame);
+    }
+    dvp_capture_stop();
+
+    dvp_capture_get_stats(&capture);
+    dvp_sim_get_stats(&sim);
+    printf("%-5s %4u shown %4u captured %4u dropped %5.1f fps, luma %3u, %7.1f host us/frame, display %08x\n", name,
+           shown, capture.captured, capture.dropped, capture.fps, stats.mean, host / 1000.0 / shown, sum);
+    printf("      sensor frames %u, converted %u, loops %u, bad addresses %u\n", sim.frames, sim.converted, sim.loops,
+           sim.bad_addresses);
+
+    /* Captured frames were consumed, dropped, or are still waiting in a slot */
+    pending = capture.captured - capture.consumed - capture.dropped;
+    if (capture.consumed != shown || capture.captured < capture.consumed + capture.dropped || pending >= SLOTS)
+    {
+        printf("FAIL %s: %u captured, %u consumed, %u dropped do not add up\n", name, capture.captured,
+               capture.consumed, capture.dropped);
+        failed = 1;
+    }
+    if (capture.switch_torn != 0 || capture.dropped > max_dropped)
+    {
+        printf("FAIL %s: %u torn, %u dropped, at most %u expected\n", name, capture.switch_torn, capture.dropped,
+               max_dropped);
+        failed = 1;
+    }
+    if (sim.converted != capture.captured || sim.bad_addresses != 0)
+    {
+        printf("FAIL %s: %u frames converted for %u captured, %u bad addresses\n", name, sim.converted,
+               capture.captured, sim.bad_addresses);
+        failed = 1;
+    }
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    float fps = argc > 1 ? atof(argv[1]) : DVP_SIM_DEFAULT_FPS;
+    uint32_t work_us = argc > 2 ? atoi(argv[2]) : 20000;
+    /* Other rates and loads may drop any number of frames, but never tear one */
+    uint32_t max_dropped = argc > 1 ? FRAMES * 100 : DEFAULT_MAX_DROPPED;
+    uint8_t *clip = NULL;
+    int failed = 0;
+
+    if (argc > 5)
+    {
+        if (dvp_sim_open(argv[3], atoi(argv[4]), atoi(argv[5])) != 0)
+        {
+            printf("cannot read %s\n", argv[3]);
+            return 1;
+        }
+    }
+    else
+    {
+        clip = make_clip();
+        if (!clip)
+            return 1;
+        dvp_sim_set_frames(clip, CLIP, FRAME_W, FRAME_H);
+    }
+    dvp_sim_set_rate(fps);
+
+    lcd_init();
+    lcd_set_direction(DIR_YX_RLDU);
+    dvp_init(8);
+    dvp_set_output_enable(DVP_OUTPUT_AI, 1);
+    dvp_set_output_enable(DVP_OUTPUT_DISPLAY, 1);
+    dvp_set_image_format(DVP_CFG_RGB_FORMAT);
+    dvp_set_image_size(FRAME_W, FRAME_H);
+    if (dvp_capture_init(FRAME_W, FRAME_H, SLOTS) != 0 ||
+        motion_detect_init(&motion, FRAME_W, FRAME_H, 4, 4, 6) != 0)
+    {
+        printf("init error\n");
+        return 1;
+    }
+
+    failed |= run("rgb", DVP_CAPTURE_RGB, work_us, max_dropped);
+    failed |= run("luma", DVP_CAPTURE_LUMA, work_us, max_dropped);
+
+    dvp_sim_close();
+    free(clip);
+    return failed;
+}
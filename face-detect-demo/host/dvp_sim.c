@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dvp.h"
+#include "dvp_sim.h"
+#include "encoding.h"
+#include "image_process.h"
+#include "plic.h"
+#include "sysctl.h"
+
+#define ADDRESS_SPAN 0x100000000ULL
+
+/* The register block is not modelled; code that pokes it directly sees no effect */
+static dvp_t sim_regs;
+volatile dvp_t *const dvp = &sim_regs;
+
+/* Where one converted frame goes, latched at its start */
+typedef struct _sim_target
+{
+    int converting;
+    int ai;
+    int display;
+    uint32_t width;
+    uint32_t height;
+    uint32_t r_addr;
+    uint32_t g_addr;
+    uint32_t b_addr;
+    uint32_t display_addr;
+} sim_target_t;
+
+static struct
+{
+    /* Source frames */
+    const uint8_t *frames;
+    uint8_t *file_data;
+    uint32_t frame_count;
+    uint32_t frame_index;
+    uint16_t src_width;
+    uint16_t src_height;
+
+    /* Configuration as the dvp_* calls left it */
+    uint32_t cfg;
+    uint32_t sts;
+    int convert_requested;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t r_addr;
+    uint32_t g_addr;
+    uint32_t b_addr;
+    uint32_t display_addr;
+    uint32_t sccb_clock;
+    uint8_t sccb_regs[65536];
+
+    /* Clock and the next frame edge */
+    uint64_t now_ns;
+    uint64_t interval_ns;
+    uint64_t next_start_ns;
+    uint64_t finish_ns;
+    int in_frame;
+    sim_target_t target;
+
+    plic_irq_callback_t handler;
+    void *handler_ctx;
+    int irq_enabled;
+
+    /* Memory within one 4 GiB window, so a 32-bit address plus the window is a pointer */
+    uint8_t *memory_raw;
+    uint8_t *memory;
+    size_t memory_used;
+
+    dvp_sim_stats_t stats;
+} sim = {
+    .interval_ns = 1000000000ULL / DVP_SIM_DEFAULT_FPS,
+    .sccb_clock = DVP_SIM_SCCB_CLOCK,
+};
+
+/* Simulated platform: clock, interrupt controller and frame memory */
+
+uint64_t read_cycle(void)
+{
+    return sim.now_ns * (DVP_SIM_CPU_HZ / 1000000) / 1000;
+}
+
+uint32_t sysctl_clock_get_freq(sysctl_clock_t clock)
+{
+    (void)clock;
+    return DVP_SIM_CPU_HZ;
+}
+
+int plic_set_priority(plic_irq_t irq_number, uint32_t priority)
+{
+    (void)irq_number;
+    (void)priority;
+    return 0;
+}
+
+void plic_irq_register(plic_irq_t irq, plic_irq_callback_t callback, void *ctx)
+{
+    if (irq != IRQN_DVP_INTERRUPT)
+        return;
+    sim.handler = callback;
+    sim.handler_ctx = ctx;
+}
+
+int plic_irq_enable(plic_irq_t irq_number)
+{
+    if (irq_number == IRQN_DVP_INTERRUPT)
+        sim.irq_enabled = 1;
+    return 0;
+}
+
+int plic_irq_disable(plic_irq_t irq_number)
+{
+    if (irq_number == IRQN_DVP_INTERRUPT)
+        sim.irq_enabled = 0;
+    return 0;
+}
+
+void *dvp_sim_alloc(size_t size)
+{
+    uint8_t *block;
+
+    if (!sim.memory)
+    {
+        uintptr_t start;
+        uintptr_t window;
+
+        /* Twice the size holds a stretch that does not cross a 4 GiB boundary */
+        sim.memory_raw = malloc(2 * DVP_SIM_MEMORY_SIZE + 64);
+        if (!sim.memory_raw)
+            return NULL;
+        start = ((uintptr_t)sim.memory_raw + 63) & ~(uintptr_t)63;
+        window = (start + ADDRESS_SPAN - 1) & ~(uintptr_t)(ADDRESS_SPAN - 1);
+        if (window > start && window < start + DVP_SIM_MEMORY_SIZE)
+            start = window;
+        sim.memory = (uint8_t *)start;
+        sim.memory_used = 0;
+    }
+
+    size = (size + 63) & ~(size_t)63;
+    if (sim.memory_used + size > DVP_SIM_MEMORY_SIZE)
+        return NULL;
+    block = sim.memory + sim.memory_used;
+    sim.memory_used += size;
+    return block;
+}
+
+/* Stands in for image_process.c, so the DVP can address the buffers */
+int image_init(image_t *image)
+{
+    image->addr = dvp_sim_alloc((size_t)image->width * image->height * image->pixel);
+    return image->addr ? 0 : -1;
+}
+
+void image_deinit(image_t *image)
+{
+    image->addr = NULL;
+}
+
+static uint8_t *sim_pointer(uint32_t addr, size_t size)
+{
+    uintptr_t base = (uintptr_t)sim.memory;
+    uintptr_t p = (base & ~(uintptr_t)(ADDRESS_SPAN - 1)) | addr;
+
+    if (!sim.memory || p < base || p + size > base + sim.memory_used)
+    {
+        sim.stats.bad_addresses++;
+        return NULL;
+    }
+    return (uint8_t *)p;
+}
+
+/* Camera */
+
+static void sim_raise(void)
+{
+    uint32_t enabled = 0;
+
+    if (sim.cfg & DVP_CFG_START_INT_ENABLE)
+        enabled |= DVP_STS_FRAME_START;
+    if (sim.cfg & DVP_CFG_FINISH_INT_ENABLE)
+        enabled |= DVP_STS_FRAME_FINISH;
+
+    /* The line stays asserted while an enabled flag is set, so the handler runs until it clears them */
+    for (int i = 0; i < 4 && sim.handler && sim.irq_enabled && (sim.sts & enabled); i++)
+        sim.handler(sim.handler_ctx);
+}
+
+static void sim_write_frame(const sim_target_t *t)
+{
+    const uint8_t *src = sim.frames + (size_t)sim.frame_index * sim.src_width * sim.src_height * 3;
+    size_t plane = (size_t)t->width * t->height;
+    uint8_t *r = NULL, *g = NULL, *b = NULL;
+    uint16_t *display = NULL;
+
+    if (t->ai)
+    {
+        r = sim_pointer(t->r_addr, plane);
+        g = sim_pointer(t->g_addr, plane);
+        b = sim_pointer(t->b_addr, plane);
+    }
+    if (t->display)
+        display = (uint16_t *)sim_pointer(t->display_addr, plane * 2);
+
+    for (uint32_t y = 0; y < t->height; y++)
+    {
+        const uint8_t *line = src + (size_t)(y * sim.src_height / t->height) * sim.src_width * 3;
+
+        for (uint32_t x = 0; x < t->width; x++)
+        {
+            const uint8_t *px = line + (size_t)(x * sim.src_width / t->width) * 3;
+            size_t i = (size_t)y * t->width + x;
+
+            if (r && g && b)
+            {
+                r[i] = px[0];
+                g[i] = px[1];
+                b[i] = px[2];
+            }
+            /* Two pixels per word, the left one in the upper halfword */
+            if (display)
+                display[i ^ 1] = ((px[0] & 0xF8) << 8) | ((px[1] & 0xFC) << 3) | (px[2] >> 3);
+        }
+    }
+}
+
+static void sim_latch(void)
+{
+    sim_target_t *t = &sim.target;
+
+    t->converting = 1;
+    sim.convert_requested = 0;
+    t->ai = (sim.cfg & DVP_CFG_AI_OUTPUT_ENABLE) != 0;
+    t->display = (sim.cfg & DVP_CFG_DISPLAY_OUTPUT_ENABLE) != 0;
+    t->width = sim.width;
+    t->height = sim.height;
+    t->r_addr = sim.r_addr;
+    t->g_addr = sim.g_addr;
+    t->b_addr = sim.b_addr;
+    t->display_addr = sim.display_addr;
+}
+
+static void sim_frame_start(void)
+{
+    sim.now_ns = sim.next_start_ns;
+    sim.next_start_ns += sim.interval_ns;
+    sim.finish_ns = sim.now_ns + sim.interval_ns * DVP_SIM_READOUT_PERCENT / 100;
+    sim.in_frame = 1;
+    sim.stats.frames++;
+
+    sim.target.converting = 0;
+    if ((sim.cfg & DVP_CFG_AUTO_ENABLE) || sim.convert_requested)
+        sim_latch();
+    sim.sts |= DVP_STS_FRAME_START;
+    sim_raise();
+}
+
+static void sim_frame_finish(void)
+{
+    sim.now_ns = sim.finish_ns;
+    sim.in_frame = 0;
+    if (sim.target.converting)
+    {
+        sim_write_frame(&sim.target);
+        sim.stats.converted++;
+        sim.sts |= DVP_STS_FRAME_FINISH;
+    }
+    if (++sim.frame_index == sim.frame_count)
+    {
+        sim.frame_index = 0;
+        sim.stats.loops++;
+    }
+    sim_raise();
+}
+
+static uint64_t sim_next_edge_ns(void)
+{
+    return sim.in_frame ? sim.finish_ns : sim.next_start_ns;
+}
+
+/* Run the next frame edge; -1 when there is nothing to play */
+static int sim_step(void)
+{
+    if (!sim.frames)
+        return -1;
+    if (sim.in_frame)
+        sim_frame_finish();
+    else
+        sim_frame_start();
+    return 0;
+}
+
+/* What a busy-wait on the status flag would see */
+static void sim_wait(uint32_t flag)
+{
+    while (!(sim.sts & flag))
+    {
+        if (sim_step() != 0)
+        {
+            fprintf(stderr, "dvp_sim: waiting for a frame with no source\n");
+            return;
+        }
+    }
+}
+
+static void sim_set_source(const uint8_t *frames, uint32_t count, uint16_t width, uint16_t height)
+{
+    sim.frames = frames;
+    sim.frame_count = count;
+    sim.frame_index = 0;
+    sim.src_width = width;
+    sim.src_height = height;
+    sim.next_start_ns = sim.now_ns;
+    sim.in_frame = 0;
+}
+
+int dvp_sim_open(const char *path, uint16_t width, uint16_t height)
+{
+    size_t frame_bytes = (size_t)width * height * 3;
+    FILE *file = fopen(path, "rb");
+    long size;
+
+    if (!file)
+        return -1;
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (frame_bytes == 0 || size < (long)frame_bytes)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    free(sim.file_data);
+    sim.file_data = malloc(size);
+    if (!sim.file_data || fread(sim.file_data, 1, size, file) != (size_t)size)
+    {
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+    sim_set_source(sim.file_data, size / frame_bytes, width, height);
+    return 0;
+}
+
+void dvp_sim_set_frames(const uint8_t *frames, uint32_t count, uint16_t width, uint16_t height)
+{
+    sim_set_source(count ? frames : NULL, count, width, height);
+}
+
+void dvp_sim_set_rate(float fps)
+{
+    sim.interval_ns = 1e9 / fps;
+    if (!sim.in_frame)
+        sim.next_start_ns = sim.now_ns;
+}
+
+void dvp_sim_advance(uint64_t ns)
+{
+    uint64_t until = sim.now_ns + ns;
+
+    while (sim.frames && sim_next_edge_ns() <= until)
+        sim_step();
+    sim.now_ns = until;
+}
+
+int dvp_sim_run_frames(uint32_t count)
+{
+    while (count)
+    {
+        int finishing = sim.in_frame;
+
+        if (sim_step() != 0)
+            return -1;
+        if (finishing)
+            count--;
+    }
+    return 0;
+}
+
+uint64_t dvp_sim_now_ns(void)
+{
+    return sim.now_ns;
+}
+
+uint8_t dvp_sim_get_reg(uint16_t reg)
+{
+    return sim.sccb_regs[reg];
+}
+
+void dvp_sim_set_reg(uint16_t reg, uint8_t value)
+{
+    sim.sccb_regs[reg] = value;
+}
+
+void dvp_sim_get_stats(dvp_sim_stats_t *stats)
+{
+    *stats = sim.stats;
+}
+
+void dvp_sim_reset_stats(void)
+{
+    memset(&sim.stats, 0, sizeof(sim.stats));
+}
+
+void dvp_sim_close(void)
+{
+    free(sim.file_data);
+    free(sim.memory_raw);
+    sim.file_data = NULL;
+    sim.memory_raw = NULL;
+    sim.memory = NULL;
+    sim.frames = NULL;
+}
+
+/* dvp.h */
+
+void dvp_init(uint8_t reg_len)
+{
+    (void)reg_len;
+    sim.cfg = 0;
+    sim.sts = 0;
+    sim.convert_requested = 0;
+}
+
+uint32_t dvp_set_xclk_rate(uint32_t xclk_rate)
+{
+    return xclk_rate;
+}
+
+uint32_t dvp_sccb_set_clk_rate(uint32_t clk_rate)
+{
+    sim.sccb_clock = clk_rate;
+    return clk_rate;
+}
+
+void dvp_set_image_format(uint32_t format)
+{
+    sim.format = format;
+}
+
+void dvp_enable_burst(void)
+{
+    sim.cfg |= DVP_CFG_BURST_SIZE_4BEATS;
+}
+
+void dvp_disable_burst(void)
+{
+    sim.cfg &= ~DVP_CFG_BURST_SIZE_4BEATS;
+}
+
+void dvp_set_image_size(uint32_t width, uint32_t height)
+{
+    sim.width = width;
+    sim.height = height;
+}
+
+void dvp_set_ai_addr(uint32_t r_addr, uint32_t g_addr, uint32_t b_addr)
+{
+    sim.r_addr = r_addr;
+    sim.g_addr = g_addr;
+    sim.b_addr = b_addr;
+}
+
+void dvp_set_display_addr(uint32_t addr)
+{
+    sim.display_addr = addr;
+}
+
+void dvp_start_frame(void)
+{
+    sim_wait(DVP_STS_FRAME_START);
+    sim.sts &= ~DVP_STS_FRAME_START;
+}
+
+void dvp_start_convert(void)
+{
+    /* Right after a frame start the DVP still catches that frame */
+    if (sim.in_frame && !sim.target.converting)
+        sim_latch();
+    else
+        sim.convert_requested = 1;
+}
+
+void dvp_finish_convert(void)
+{
+    sim_wait(DVP_STS_FRAME_FINISH);
+    sim.sts &= ~DVP_STS_FRAME_FINISH;
+}
+
+void dvp_get_image(void)
+{
+    sim_wait(DVP_STS_FRAME_START);
+    sim.sts &= ~DVP_STS_FRAME_START;
+    sim_wait(DVP_STS_FRAME_START);
+    sim.sts &= ~(DVP_STS_FRAME_START | DVP_STS_FRAME_FINISH);
+    dvp_start_convert();
+    sim_wait(DVP_STS_FRAME_FINISH);
+}
+
+/* Charge the bus time of a transfer, bytes of 9 bits each, to the clock */
+static void sim_sccb_transfer(uint32_t bytes)
+{
+    dvp_sim_advance((uint64_t)bytes * 9 * 1000000000ULL / sim.sccb_clock);
+}
+
+void dvp_sccb_send_data(uint8_t dev_addr, uint16_t reg_addr, uint8_t reg_data)
+{
+    (void)dev_addr;
+    sim_sccb_transfer(3);
+    sim.sccb_regs[reg_addr] = reg_data;
+    sim.stats.sccb_writes++;
+}
+
+uint8_t dvp_sccb_receive_data(uint8_t dev_addr, uint16_t reg_addr)
+{
+    (void)dev_addr;
+    /* Register address write, then the read */
+    sim_sccb_transfer(2);
+    sim_sccb_transfer(2);
+    sim.stats.sccb_reads++;
+    return sim.sccb_regs[reg_addr];
+}
+
+void dvp_config_interrupt(uint32_t interrupt, uint8_t enable)
+{
+    if (enable)
+        sim.cfg |= interrupt;
+    else
+        sim.cfg &= ~interrupt;
+}
+
+int dvp_get_interrupt(uint32_t interrupt)
+{
+    return (sim.sts & interrupt) != 0;
+}
+
+void dvp_clear_interrupt(uint32_t interrupt)
+{
+    sim.sts &= ~interrupt;
+}
+
+void dvp_enable_auto(void)
+{
+    sim.cfg |= DVP_CFG_AUTO_ENABLE;
+}
+
+void dvp_disable_auto(void)
+{
+    sim.cfg &= ~DVP_CFG_AUTO_ENABLE;
+}
+
+void dvp_set_output_enable(dvp_output_mode_t index, int enable)
+{
+    uint32_t bit = index == DVP_OUTPUT_AI ? DVP_CFG_AI_OUTPUT_ENABLE : DVP_CFG_DISPLAY_OUTPUT_ENABLE;
+
+    if (enable)
+        sim.cfg |= bit;
+    else
+        sim.cfg &= ~bit;
+}
@@ -0,0 +1,70 @@
+#ifndef _DVP_SIM_H_
+#define _DVP_SIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* clang-format off */
+#define DVP_SIM_CPU_HZ          400000000
+#define DVP_SIM_DEFAULT_FPS     30
+/* Share of the frame interval the sensor spends reading a frame out */
+#define DVP_SIM_READOUT_PERCENT 80
+#define DVP_SIM_SCCB_CLOCK      100000
+/* Memory the DVP's 32-bit addresses reach, as much as the K210 has */
+#define DVP_SIM_MEMORY_SIZE     (6 * 1024 * 1024)
+/* clang-format on */
+
+typedef struct _dvp_sim_stats
+{
+    /* Frames the sensor sent, converted or not */
+    uint32_t frames;
+    /* Frames written to memory */
+    uint32_t converted;
+    /* Times playback wrapped around to the first frame */
+    uint32_t loops;
+    uint32_t sccb_writes;
+    uint32_t sccb_reads;
+    /* Outputs not written because their address is outside simulated memory */
+    uint32_t bad_addresses;
+} dvp_sim_stats_t;
+
+/*
+ * Simulated camera behind the dvp_* API, for running capture pipelines on a
+ * Linux host. Frames come from a raw RGB888 sequence (width x height x 3
+ * bytes per frame, back to back) played on a simulated clock: frame n
+ * starts at n / fps and finishes DVP_SIM_READOUT_PERCENT of an interval
+ * later, and playback loops at the end. Each edge sets its status flag and
+ * calls the IRQN_DVP_INTERRUPT handler when its interrupt is enabled. A
+ * frame converted in auto mode or after dvp_start_convert is scaled to
+ * dvp_set_image_size, nearest neighbour, and written at its finish to the
+ * AI planes and display frame that were set when its conversion began.
+ *
+ * Time only moves when the program lets it: dvp_sim_advance,
+ * dvp_sim_run_frames, the blocking dvp_* calls, and SCCB transfers, which
+ * take as long as they would on the bus. The same program therefore sees
+ * the same frames at the same cycles on every run. The image format is
+ * recorded, but frames always arrive as RGB.
+ *
+ * DVP addresses are 32-bit, so frame buffers live in simulated memory:
+ * image_init allocates there, and memory is only given back by
+ * dvp_sim_close.
+ */
+int dvp_sim_open(const char *path, uint16_t width, uint16_t height);
+/* Play frames from memory instead; the caller keeps them alive */
+void dvp_sim_set_frames(const uint8_t *frames, uint32_t count, uint16_t width, uint16_t height);
+void dvp_sim_set_rate(float fps);
+/* Let time pass, delivering the frame edges due meanwhile */
+void dvp_sim_advance(uint64_t ns);
+/* Run until count more frames have finished; -1 without a source */
+int dvp_sim_run_frames(uint32_t count);
+uint64_t dvp_sim_now_ns(void);
+/* Memory DVP addresses can point at, 64-byte aligned; NULL when exhausted */
+void *dvp_sim_alloc(size_t size);
+/* The sensor's register file as written over SCCB */
+uint8_t dvp_sim_get_reg(uint16_t reg);
+void dvp_sim_set_reg(uint16_t reg, uint8_t value);
+void dvp_sim_get_stats(dvp_sim_stats_t *stats);
+void dvp_sim_reset_stats(void);
+void dvp_sim_close(void);
+
+#endif
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <string.h>
+#include "lcd.h"
+#include "lcd_fb.h"
+
+#define FRAME_W 320
+#define FRAME_H 240
+/* Small target for the clipping checks, so every shape hangs off an edge */
+#define CLIP_W  64
+#define CLIP_H  48
+/* Words on either side of a framebuffer that nothing may write */
+#define GUARD   64
+#define POISON  0xDEADBEEF
+
+static uint32_t canvas[GUARD + FRAME_W * FRAME_H / 2 + GUARD];
+static uint16_t ref[CLIP_H][CLIP_W];
+static uint32_t sprite[16 * 16 / 2];
+
+static uint32_t *canvas_gram(void)
+{
+    return canvas + GUARD;
+}
+
+static void canvas_reset(uint32_t words, uint16_t color)
+{
+    for (uint32_t i = 0; i < GUARD; i++)
+        canvas[i] = canvas[GUARD + words + i] = POISON;
+    for (uint32_t i = 0; i < words; i++)
+        canvas[GUARD + i] = ((uint32_t)color << 16) | color;
+}
+
+static int canvas_guard_ok(uint32_t words)
+{
+    for (uint32_t i = 0; i < GUARD; i++)
+        if (canvas[i] != POISON || canvas[GUARD + words + i] != POISON)
+            return 0;
+    return 1;
+}
+
+static uint16_t gram_pixel(const uint32_t *gram, uint16_t width, int32_t x, int32_t y)
+{
+    return ((const uint16_t *)gram)[(y * width + x) ^ 1];
+}
+
+/* The reference model: one pixel at a time, clipped one pixel at a time */
+static void ref_fill(int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color)
+{
+    for (int32_t y = y1; y <= y2; y++)
+        for (int32_t x = x1; x <= x2; x++)
+            if (x >= 0 && y >= 0 && x < CLIP_W && y < CLIP_H)
+                ref[y][x] = color;
+}
+
+static void ref_blit(int32_t x0, int32_t y0, const uint32_t *src, uint16_t width, uint16_t height, int keyed,
+                     uint16_t key)
+{
+    for (int32_t y = 0; y < height; y++)
+    {
+        for (int32_t x = 0; x < width; x++)
+        {
+            uint16_t pixel = gram_pixel(src, width, x, y);
+
+            if (!(keyed && pixel == key))
+                ref_fill(x0 + x, y0 + y, x0 + x, y0 + y, pixel);
+        }
+    }
+}
+
+/* A ring of colours around a key-coloured centre */
+static void make_sprite(void)
+{
+    for (int32_t y = 0; y < 16; y++)
+    {
+        for (int32_t x = 0; x < 16; x++)
+        {
+            int32_t dx = 2 * x - 15, dy = 2 * y - 15;
+            int32_t r2 = dx * dx + dy * dy;
+            uint16_t color = r2 < 100 ? MAGENTA : r2 < 225 ? (uint16_t)((x << 12) | (y << 6) | 0x1F) : BLACK;
+
+            ((uint16_t *)sprite)[(y * 16 + x) ^ 1] = color;
+        }
+    }
+}
+
+/*
+ * Each case draws on the small target and then on the reference model; the
+ * two must agree everywhere and nothing outside the target may change.
+ */
+static int check_clipping(void)
+{
+    const uint32_t words = CLIP_W * CLIP_H / 2;
+    lcd_fb_t fb;
+    int failed = 0;
+
+    lcd_fb_init(&fb, canvas_gram(), CLIP_W, CLIP_H);
+    for (uint32_t n = 0; n < 8; n++)
+    {
+        /* Odd and even phases, hanging off every edge in turn */
+        int32_t x1 = -5 + (int32_t)n * 9 - (n & 1), y1 = -7 + (int32_t)n * 7;
+        int32_t x2 = x1 + 23 + (int32_t)n, y2 = y1 + 13;
+        const char *name = NULL;
+
+        canvas_reset(words, NAVY);
+        ref_fill(0, 0, CLIP_W - 1, CLIP_H - 1, NAVY);
+
+        lcd_fb_hline(&fb, x2, x1, y1 + 2, RED);
+        ref_fill(x1, y1 + 2, x2, y1 + 2, RED);
+        lcd_fb_vline(&fb, x1 + 3, y2, y1 - 20, GREEN);
+        ref_fill(x1 + 3, y1 - 20, x1 + 3, y2, GREEN);
+        lcd_fb_fill_rect(&fb, x1 + 1, y1 + 4, x2 + 9, y2 + 30, YELLOW);
+        ref_fill(x1 + 1, y1 + 4, x2 + 9, y2 + 30, YELLOW);
+        lcd_fb_rect(&fb, x1, y1, x2, y2, 3, CYAN);
+        ref_fill(x1, y1, x2, y1 + 2, CYAN);
+        ref_fill(x1, y2 - 2, x2, y2, CYAN);
+        ref_fill(x1, y1, x1 + 2, y2, CYAN);
+        ref_fill(x2 - 2, y1, x2, y2, CYAN);
+        lcd_fb_blit(&fb, CLIP_W - 9 - (int32_t)n * 7, y1, sprite, 16, 16);
+        ref_blit(CLIP_W - 9 - (int32_t)n * 7, y1, sprite, 16, 16, 0, 0);
+        lcd_fb_blit_key(&fb, x1 - 3, y2 - 9, sprite, 16, 16, MAGENTA);
+        ref_blit(x1 - 3, y2 - 9, sprite, 16, 16, 1, MAGENTA);
+
+        if (!canvas_guard_ok(words))
+            name = "wrote outside the framebuffer";
+        for (int32_t y = 0; y < CLIP_H && !name; y++)
+            for (int32_t x = 0; x < CLIP_W && !name; x++)
+                if (gram_pixel(canvas_gram(), CLIP_W, x, y) != ref[y][x])
+                    name = "differs from the reference";
+        if (name)
+        {
+            printf("FAIL clip case %u at (%d,%d)-(%d,%d): %s\n", n, x1, y1, x2, y2, name);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+/* Every primitive on one frame, shapes crossing all four edges, for eyeballing and image diffs */
+static void render_scene(lcd_fb_t *fb)
+{
+    canvas_reset(FRAME_W * FRAME_H / 2, NAVY);
+    for (int32_t y = 0; y < FRAME_H; y += 40)
+        lcd_fb_fill_rect(fb, 0, y, FRAME_W - 1, y + 19, DARKGREY);
+    lcd_fb_rect(fb, -10, -10, 329, 249, 14, OLIVE);
+    lcd_fb_fill_rect(fb, 20, 20, 99, 69, DARKGREEN);
+    lcd_fb_rect(fb, 121, 21, 200, 70, 1, WHITE);
+    lcd_fb_rect(fb, 220, 20, 299, 70, 5, ORANGE);
+    for (int32_t k = 0; k < 12; k++)
+    {
+        lcd_fb_line(fb, 160, 150, 160 + (k - 6) * 60, -40, GREENYELLOW);
+        lcd_fb_line(fb, 160, 150, 400, 100 + k * 15, PINK);
+    }
+    lcd_fb_corners(fb, 30, 90, 131, 201, 18, 3, RED);
+    lcd_fb_corners(fb, -20, 150, 40, 260, 12, 2, CYAN);
+    for (int32_t k = 0; k < 6; k++)
+    {
+        lcd_fb_blit(fb, 190 + k * 23, 180, sprite, 16, 16);
+        lcd_fb_blit_key(fb, 189 + k * 23, 200, sprite, 16, 16, MAGENTA);
+        lcd_fb_blit_alpha(fb, 190 + k * 23, 220, sprite, 16, 16, (uint8_t)(k * 51));
+    }
+    lcd_fb_blit_key(fb, -7, 60, sprite, 16, 16, MAGENTA);
+    lcd_fb_blit_alpha(fb, 311, 100, sprite, 16, 16, 160);
+    for (int32_t k = 0; k < 8; k++)
+        lcd_fb_point(fb, 140 + 2 * k, 80 + k, WHITE);
+}
+
+static int write_ppm(const char *path, const uint32_t *gram, uint16_t width, uint16_t height)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL)
+        return -1;
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    for (int32_t y = 0; y < height; y++)
+    {
+        for (int32_t x = 0; x < width; x++)
+        {
+            uint16_t p = gram_pixel(gram, width, x, y);
+            uint8_t r5 = p >> 11, g6 = (p >> 5) & 0x3F, b5 = p & 0x1F;
+            uint8_t rgb[3] = {(r5 << 3) | (r5 >> 2), (g6 << 2) | (g6 >> 4), (b5 << 3) | (b5 >> 2)};
+
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    return fclose(file);
+}
+
+/* FNV-1a, so a changed rendering shows without keeping a golden image around */
+static uint32_t checksum(const uint32_t *gram, uint32_t words)
+{
+    const uint8_t *data = (const uint8_t *)gram;
+    uint32_t h = 2166136261U;
+
+    for (uint32_t i = 0; i < words * 4; i++)
+        h = (h ^ data[i]) * 16777619U;
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    lcd_fb_t fb;
+    int failed;
+
+    make_sprite();
+    failed = check_clipping();
+    printf("clipping: %s\n", failed ? "FAIL" : "ok");
+
+    lcd_fb_init(&fb, canvas_gram(), FRAME_W, FRAME_H);
+    render_scene(&fb);
+    if (!canvas_guard_ok(FRAME_W * FRAME_H / 2))
+    {
+        printf("FAIL scene wrote outside the framebuffer\n");
+        failed = 1;
+    }
+    printf("scene: %08x\n", checksum(canvas_gram(), FRAME_W * FRAME_H / 2));
+
+    if (argc > 1 && write_ppm(argv[1], canvas_gram(), FRAME_W, FRAME_H) != 0)
+    {
+        printf("cannot write %s\n", argv[1]);
+        return 1;
+    }
+    return failed;
+}
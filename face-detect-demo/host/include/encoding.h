@@ -0,0 +1,18 @@
+#ifndef _HOST_ENCODING_H
+#define _HOST_ENCODING_H
+
+#include <stdint.h>
+
+/*
+ * Host stand-in for the SDK header. Simulated interrupts run synchronously
+ * from the simulator, never in the middle of masked code, so masking only
+ * has to report interrupts as enabled. Cycles count simulated time.
+ */
+#define MSTATUS_MIE 0x00000008
+
+#define clear_csr(reg, bit) ((unsigned long)(bit))
+#define set_csr(reg, bit) ((void)(bit))
+
+uint64_t read_cycle(void);
+
+#endif /* _HOST_ENCODING_H */
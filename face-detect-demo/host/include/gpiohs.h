@@ -0,0 +1,24 @@
+#ifndef _HOST_GPIOHS_H
+#define _HOST_GPIOHS_H
+
+#include <stdint.h>
+
+/* Host stand-in for the SDK header: the pins the NT35310 driver drives, DCX among them */
+typedef enum _gpio_drive_mode
+{
+    GPIO_DM_INPUT,
+    GPIO_DM_INPUT_PULL_DOWN,
+    GPIO_DM_INPUT_PULL_UP,
+    GPIO_DM_OUTPUT,
+} gpio_drive_mode_t;
+
+typedef enum _gpio_pin_value
+{
+    GPIO_PV_LOW,
+    GPIO_PV_HIGH
+} gpio_pin_value_t;
+
+void gpiohs_set_drive_mode(uint8_t pin, gpio_drive_mode_t mode);
+void gpiohs_set_pin(uint8_t pin, gpio_pin_value_t value);
+
+#endif /* _HOST_GPIOHS_H */
@@ -0,0 +1,27 @@
+#ifndef _HOST_PLIC_H
+#define _HOST_PLIC_H
+
+#include <stdint.h>
+
+/* Host stand-in for the SDK header: the callback type and the calls the demo layers use */
+typedef int (*plic_irq_callback_t)(void *ctx);
+
+typedef struct _plic_callback_t
+{
+    plic_irq_callback_t callback;
+    void *ctx;
+    uint32_t priority;
+} plic_interrupt_t;
+
+typedef enum _plic_irq
+{
+    IRQN_DVP_INTERRUPT = 24,
+    IRQN_MAX = 65,
+} plic_irq_t;
+
+int plic_set_priority(plic_irq_t irq_number, uint32_t priority);
+void plic_irq_register(plic_irq_t irq, plic_irq_callback_t callback, void *ctx);
+int plic_irq_enable(plic_irq_t irq_number);
+int plic_irq_disable(plic_irq_t irq_number);
+
+#endif /* _HOST_PLIC_H */
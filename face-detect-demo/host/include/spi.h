@@ -0,0 +1,89 @@
+#ifndef _HOST_SPI_H
+#define _HOST_SPI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "plic.h"
+
+/*
+ * Host stand-in for the SDK header: the SPI and DMA calls the NT35310 driver
+ * makes, served by the panel model in nt35310_sim.c.
+ */
+typedef enum _dmac_channel_number
+{
+    DMAC_CHANNEL0 = 0,
+    DMAC_CHANNEL1,
+} dmac_channel_number_t;
+
+typedef enum _spi_device_num
+{
+    SPI_DEVICE_0,
+    SPI_DEVICE_1,
+} spi_device_num_t;
+
+typedef enum _spi_work_mode
+{
+    SPI_WORK_MODE_0,
+} spi_work_mode_t;
+
+typedef enum _spi_frame_format
+{
+    SPI_FF_STANDARD,
+    SPI_FF_DUAL,
+    SPI_FF_QUAD,
+    SPI_FF_OCTAL
+} spi_frame_format_t;
+
+typedef enum _spi_instruction_address_trans_mode
+{
+    SPI_AITM_STANDARD,
+    SPI_AITM_ADDR_STANDARD,
+    SPI_AITM_AS_FRAME_FORMAT
+} spi_instruction_address_trans_mode_t;
+
+typedef enum _spi_transfer_mode
+{
+    SPI_TMOD_TRANS_RECV,
+    SPI_TMOD_TRANS,
+} spi_transfer_mode_t;
+
+typedef enum _spi_transfer_width
+{
+    SPI_TRANS_CHAR = 0x1,
+    SPI_TRANS_SHORT = 0x2,
+    SPI_TRANS_INT = 0x4,
+} spi_transfer_width_t;
+
+typedef int spi_chip_select_t;
+
+typedef struct _spi_data_t
+{
+    dmac_channel_number_t tx_channel;
+    dmac_channel_number_t rx_channel;
+    uint32_t *tx_buf;
+    size_t tx_len;
+    uint32_t *rx_buf;
+    size_t rx_len;
+    spi_transfer_mode_t transfer_mode;
+    bool fill_mode;
+} spi_data_t;
+
+void spi_init(spi_device_num_t spi_num, spi_work_mode_t work_mode, spi_frame_format_t frame_format,
+              size_t data_bit_length, uint32_t endian);
+void spi_init_non_standard(spi_device_num_t spi_num, uint32_t instruction_length, uint32_t address_length,
+                           uint32_t wait_cycles, spi_instruction_address_trans_mode_t instruction_address_trans_mode);
+uint32_t spi_set_clk_rate(spi_device_num_t spi_num, uint32_t spi_clk);
+void spi_send_data_normal_dma(dmac_channel_number_t channel_num, spi_device_num_t spi_num,
+                              spi_chip_select_t chip_select,
+                              const void *tx_buff, size_t tx_len, spi_transfer_width_t spi_transfer_width);
+void spi_fill_data_dma(dmac_channel_number_t channel_num, spi_device_num_t spi_num, spi_chip_select_t chip_select,
+                       const uint32_t *tx_buff, size_t tx_len);
+/* Only reads the buffer when the transfer completes, on the next poll */
+void spi_handle_data_dma(spi_device_num_t spi_num, spi_chip_select_t chip_select, spi_data_t data, plic_interrupt_t *cb);
+
+/* There is no DMA running alongside the driver, so its polls move the transfer on */
+void spi_sim_poll(void);
+#define SPI_DMA_POLL() spi_sim_poll()
+
+#endif /* _HOST_SPI_H */
@@ -0,0 +1,15 @@
+#ifndef _HOST_SYSCTL_H
+#define _HOST_SYSCTL_H
+
+#include <stdint.h>
+
+/* Host stand-in for the SDK header: only the clock query the capture layer uses */
+typedef enum _sysctl_clock
+{
+    SYSCTL_CLOCK_CPU,
+    SYSCTL_CLOCK_APB1,
+} sysctl_clock_t;
+
+uint32_t sysctl_clock_get_freq(sysctl_clock_t clock);
+
+#endif /* _HOST_SYSCTL_H */
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "lcd.h"
+#include "lcd_dirty.h"
+#include "lcd_overlay.h"
+#include "lcd_sim.h"
+
+#define FRAME_W 320
+#define FRAME_H 240
+#define FRAMES  30
+
+static uint32_t frame[FRAME_W * FRAME_H / 2];
+static int failed;
+
+/* Print a phase and check what reached the panel: commands, address windows and pixels */
+static void report(const char *name, uint32_t commands, uint32_t area_sets, uint64_t pixels)
+{
+    lcd_sim_stats_t stats;
+
+    lcd_wait_idle();
+    lcd_sim_get_stats(&stats);
+    printf("%-18s %6u cmds %5u areas %6u xfers %4u reconf %9llu bytes %8.2f ms\n", name, stats.commands,
+           stats.area_sets, stats.transfers, stats.reconfigs, (unsigned long long)stats.bytes, stats.spi_ns / 1e6);
+    if (stats.commands != commands || stats.area_sets != area_sets || stats.pixels != pixels)
+    {
+        printf("FAIL %s: %u commands, %u areas, %llu pixels; expected %u, %u, %llu\n", name, stats.commands,
+               stats.area_sets, (unsigned long long)stats.pixels, commands, area_sets, (unsigned long long)pixels);
+        failed = 1;
+    }
+    lcd_sim_reset_stats();
+}
+
+/* Rectangle fills send whole words, so an odd area carries one extra pixel */
+static uint32_t fill_pixels(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2)
+{
+    return ((x2 - x1 + 1) * (y2 - y1 + 1) + 1) & ~1u;
+}
+
+/* Moving gradient with a still background, roughly what the camera delivers */
+static void render_frame(uint32_t n)
+{
+    for (uint32_t y = 0; y < FRAME_H; y++)
+    {
+        for (uint32_t x = 0; x < FRAME_W; x++)
+        {
+            uint16_t color = (x / 40 + y / 40) & 1 ? DARKGREY : NAVY;
+
+            if (x >= 100 + 4 * n && x < 160 + 4 * n && y >= 80 && y < 140)
+                color = (uint16_t)((x + y + n) << 5);
+            ((uint16_t *)frame)[(y * FRAME_W + x) ^ 1] = color;
+        }
+    }
+}
+
+/* The panel shows the last frame wherever its overlay items do not reach, and their corners in red */
+static int check_panel(uint32_t n)
+{
+    uint16_t x1 = 96 + 4 * n, y1 = 56, x2 = 163 + 4 * n, y2 = 143;
+
+    for (uint32_t y = 0; y < FRAME_H; y++)
+    {
+        for (uint32_t x = 0; x < FRAME_W; x++)
+        {
+            uint16_t want = ((uint16_t *)frame)[(y * FRAME_W + x) ^ 1];
+            uint16_t got = lcd_sim_get_pixel(x, y);
+
+            if (x >= x1 && x <= x2 && y >= y1 && y <= y2)
+                continue;
+            if (got != want)
+            {
+                printf("FAIL panel at (%u,%u): %04x, expected %04x\n", x, y, got, want);
+                return 1;
+            }
+        }
+    }
+    if (lcd_sim_get_pixel(x1, 76) != RED || lcd_sim_get_pixel(x2, y2) != RED)
+    {
+        printf("FAIL overlay corners not drawn\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static lcd_dirty_t dirty;
+    static lcd_overlay_t overlay;
+
+    lcd_sim_set_transfer_overhead(argc > 2 ? atoi(argv[2]) : 2000);
+    lcd_init();
+    lcd_set_direction(DIR_YX_RLDU);
+    /* Reset, sleep out, pixel format, MADCTL and display on, then MADCTL again */
+    report("init", 6, 0, 0);
+
+    /* Every address window is column set, page set and memory write */
+    lcd_clear(BLACK);
+    report("clear", 3, 1, FRAME_W * FRAME_H);
+    lcd_draw_string(8, 8, "face detect", WHITE);
+    report("string", 3, 1, 11 * 8 * 16);
+    lcd_draw_rectangle(4, 4, 315, 235, 2, GREEN);
+    report("rectangle", 4 * 3, 4,
+           2 * fill_pixels(4, 4, 315, 5) + 2 * fill_pixels(4, 4, 5, 235));
+    /* Frame, then the 302-pixel inner bar split at 40% */
+    lcd_draw_progress(8, 210, 311, 225, 40, 100, YELLOW, BLACK);
+    report("progress", 6 * 3, 6,
+           2 * fill_pixels(8, 210, 311, 210) + 2 * fill_pixels(8, 210, 8, 225) + fill_pixels(9, 211, 128, 224) +
+               fill_pixels(129, 211, 310, 224));
+
+    lcd_dirty_init(&dirty, frame, FRAME_W, FRAME_H);
+    lcd_overlay_init(&overlay);
+    lcd_dirty_set_overlay(&dirty, &overlay);
+    for (uint32_t n = 0; n < FRAMES; n++)
+    {
+        /* A full-frame flush may still be streaming from the buffer */
+        lcd_wait_idle();
+        render_frame(n);
+        lcd_overlay_clear(&overlay);
+        lcd_overlay_add_box(&overlay, 96 + 4 * n, 76, 163 + 4 * n, 143, LCD_OVERLAY_CORNERS, 2, RED);
+        lcd_overlay_add_text(&overlay, 96 + 4 * n, 56, "face", RED);
+        lcd_dirty_set_gram(&dirty, frame);
+        lcd_dirty_diff(&dirty);
+        lcd_dirty_flush(&dirty);
+    }
+    {
+        lcd_sim_stats_t stats;
+
+        lcd_sim_get_stats(&stats);
+        report("dirty frames", stats.area_sets * 3, stats.area_sets, dirty.total_bytes / 2);
+    }
+    failed |= check_panel(FRAMES - 1);
+
+    if (argc > 1 && lcd_sim_dump_ppm(argv[1]) != 0)
+    {
+        printf("cannot write %s\n", argv[1]);
+        return 1;
+    }
+    return failed;
+}
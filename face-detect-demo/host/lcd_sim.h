@@ -0,0 +1,41 @@
+#ifndef _LCD_SIM_H_
+#define _LCD_SIM_H_
+
+#include <stdint.h>
+
+/* clang-format off */
+#define LCD_SIM_DEFAULT_CLOCK   18000000
+/* clang-format on */
+
+typedef struct _lcd_sim_stats
+{
+    uint32_t commands;
+    uint32_t area_sets;
+    uint32_t transfers;
+    uint32_t reconfigs;
+    uint64_t bytes;
+    uint64_t pixels;
+    /* Time on the wire at the configured clock plus per-transfer overhead */
+    uint64_t spi_ns;
+} lcd_sim_stats_t;
+
+/*
+ * In-memory NT35310 model behind the SPI and GPIOHS calls of the real driver,
+ * for running the LCD layer on a Linux host. Frames are decoded the way the
+ * panel does, as commands or data by the DCX pin: column/page address set,
+ * memory write and MADCTL row/column exchange. A DMA transfer started with
+ * spi_handle_data_dma is sent only when the driver next polls for it, so
+ * buffers reused before the transfer ends show up in the pixels. Pixel data lands
+ * in a GRAM model that can be read back or dumped as PPM. The mirror bits
+ * of MADCTL are not modelled, so dumps show the frame as it was addressed.
+ */
+void lcd_sim_set_clock(uint32_t hz);
+/* Fixed cost charged per SPI transfer, e.g. DMA and chip-select setup */
+void lcd_sim_set_transfer_overhead(uint32_t ns);
+void lcd_sim_get_stats(lcd_sim_stats_t *stats);
+void lcd_sim_reset_stats(void);
+void lcd_sim_get_size(uint16_t *width, uint16_t *height);
+uint16_t lcd_sim_get_pixel(uint16_t x, uint16_t y);
+int lcd_sim_dump_ppm(const char *path);
+
+#endif
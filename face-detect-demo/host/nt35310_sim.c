@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board_config.h"
+#include "encoding.h"
+#include "gpiohs.h"
+#include "nt35310.h"
+#include "spi.h"
+#include "lcd.h"
+#include "lcd_sim.h"
+
+#define SIM_SIDE (LCD_Y_MAX > LCD_X_MAX ? LCD_Y_MAX : LCD_X_MAX)
+
+static struct
+{
+    uint16_t gram[SIM_SIDE * SIM_SIDE];
+    uint8_t madctl;
+    uint8_t cmd;
+    uint8_t param[4];
+    uint8_t param_count;
+    uint16_t x1, x2, y1, y2;
+    uint16_t cx, cy;
+    /* High byte of a pixel sent over 8-bit frames */
+    int16_t pending;
+    uint8_t dcx;
+    uint8_t frame_bits;
+    /* The DMA transfer started last, sent when the driver polls for it */
+    struct
+    {
+        int active;
+        const uint32_t *buf;
+        size_t len;
+        plic_irq_callback_t callback;
+        void *ctx;
+    } dma;
+    uint32_t clock;
+    uint32_t overhead_ns;
+    lcd_sim_stats_t stats;
+} sim = {
+    .pending = -1,
+    .dcx = GPIO_PV_HIGH,
+    .frame_bits = 8,
+    .clock = LCD_SIM_DEFAULT_CLOCK,
+    .x2 = SIM_SIDE - 1,
+    .y2 = SIM_SIDE - 1,
+};
+
+static uint16_t sim_width(void)
+{
+    return (sim.madctl & DIR_XY_MASK) ? LCD_Y_MAX : LCD_X_MAX;
+}
+
+static uint16_t sim_height(void)
+{
+    return (sim.madctl & DIR_XY_MASK) ? LCD_X_MAX : LCD_Y_MAX;
+}
+
+/* The driver waits for a DMA transfer before starting anything else on the bus */
+static void sim_check_idle(const char *what)
+{
+    if (sim.dma.active)
+    {
+        fprintf(stderr, "lcd_sim: %s while a DMA transfer is in flight\n", what);
+        abort();
+    }
+}
+
+static void sim_transfer(uint64_t bits)
+{
+    sim.stats.transfers++;
+    sim.stats.bytes += bits / 8;
+    sim.stats.spi_ns += bits * 1000000000ULL / sim.clock + sim.overhead_ns;
+}
+
+static void sim_pixel(uint16_t color)
+{
+    if (sim.cmd != MEMORY_WRITE)
+        return;
+    if (sim.cx < sim_width() && sim.cy < sim_height())
+        sim.gram[sim.cy * SIM_SIDE + sim.cx] = color;
+    sim.stats.pixels++;
+    if (++sim.cx > sim.x2)
+    {
+        sim.cx = sim.x1;
+        if (++sim.cy > sim.y2)
+            sim.cy = sim.y1;
+    }
+}
+
+static void sim_data_byte(uint8_t data)
+{
+    if (sim.cmd == MEMORY_WRITE)
+    {
+        if (sim.pending < 0)
+        {
+            sim.pending = data;
+        }
+        else
+        {
+            sim_pixel((uint16_t)(sim.pending << 8) | data);
+            sim.pending = -1;
+        }
+        return;
+    }
+
+    if (sim.param_count < sizeof(sim.param))
+        sim.param[sim.param_count] = data;
+    sim.param_count++;
+    if (sim.cmd == MEMORY_ACCESS_CTL && sim.param_count == 1)
+        sim.madctl = data;
+    if (sim.param_count == 4 && sim.cmd == HORIZONTAL_ADDRESS_SET)
+    {
+        sim.x1 = (sim.param[0] << 8) | sim.param[1];
+        sim.x2 = (sim.param[2] << 8) | sim.param[3];
+    }
+    if (sim.param_count == 4 && sim.cmd == VERTICAL_ADDRESS_SET)
+    {
+        sim.y1 = (sim.param[0] << 8) | sim.param[1];
+        sim.y2 = (sim.param[2] << 8) | sim.param[3];
+        sim.stats.area_sets++;
+    }
+}
+
+static void sim_command(uint8_t cmd)
+{
+    sim.stats.commands++;
+    sim.cmd = cmd;
+    sim.param_count = 0;
+    sim.pending = -1;
+    if (cmd == MEMORY_WRITE)
+    {
+        sim.cx = sim.x1;
+        sim.cy = sim.y1;
+    }
+}
+
+/* One SPI frame, MSB first, decoded as command or data by the DCX level */
+static void sim_frame(uint32_t value)
+{
+    for (int shift = sim.frame_bits - 8; shift >= 0; shift -= 8)
+    {
+        uint8_t byte = (uint8_t)(value >> shift);
+
+        if (sim.dcx == GPIO_PV_LOW)
+            sim_command(byte);
+        else
+            sim_data_byte(byte);
+    }
+}
+
+/* Frames narrower than the transfer width take the low bits of each item */
+static void sim_send(const void *buf, size_t len, spi_transfer_width_t width)
+{
+    uint32_t mask = sim.frame_bits < 32 ? (1u << sim.frame_bits) - 1 : 0xFFFFFFFF;
+
+    sim_transfer((uint64_t)len * sim.frame_bits);
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t value;
+
+        if (width == SPI_TRANS_CHAR)
+            value = ((const uint8_t *)buf)[i];
+        else if (width == SPI_TRANS_SHORT)
+            value = ((const uint16_t *)buf)[i];
+        else
+            value = ((const uint32_t *)buf)[i];
+        sim_frame(value & mask);
+    }
+}
+
+void gpiohs_set_drive_mode(uint8_t pin, gpio_drive_mode_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+void gpiohs_set_pin(uint8_t pin, gpio_pin_value_t value)
+{
+    if (pin != LCD_DC_IO)
+        return;
+    sim_check_idle("DCX changed");
+    sim.dcx = value;
+}
+
+void spi_init(spi_device_num_t spi_num, spi_work_mode_t work_mode, spi_frame_format_t frame_format,
+              size_t data_bit_length, uint32_t endian)
+{
+    (void)spi_num;
+    (void)work_mode;
+    (void)frame_format;
+    (void)endian;
+    sim_check_idle("spi_init");
+    sim.frame_bits = (uint8_t)data_bit_length;
+    sim.stats.reconfigs++;
+}
+
+void spi_init_non_standard(spi_device_num_t spi_num, uint32_t instruction_length, uint32_t address_length,
+                           uint32_t wait_cycles, spi_instruction_address_trans_mode_t instruction_address_trans_mode)
+{
+    (void)spi_num;
+    (void)instruction_length;
+    (void)address_length;
+    (void)wait_cycles;
+    (void)instruction_address_trans_mode;
+    sim_check_idle("spi_init_non_standard");
+}
+
+/* Wire time follows lcd_sim_set_clock, so benches can try other rates */
+uint32_t spi_set_clk_rate(spi_device_num_t spi_num, uint32_t spi_clk)
+{
+    (void)spi_num;
+    return spi_clk;
+}
+
+void spi_send_data_normal_dma(dmac_channel_number_t channel_num, spi_device_num_t spi_num,
+                              spi_chip_select_t chip_select,
+                              const void *tx_buff, size_t tx_len, spi_transfer_width_t spi_transfer_width)
+{
+    (void)channel_num;
+    (void)spi_num;
+    (void)chip_select;
+    sim_check_idle("blocking send");
+    sim_send(tx_buff, tx_len, spi_transfer_width);
+}
+
+void spi_fill_data_dma(dmac_channel_number_t channel_num, spi_device_num_t spi_num, spi_chip_select_t chip_select,
+                       const uint32_t *tx_buff, size_t tx_len)
+{
+    (void)channel_num;
+    (void)spi_num;
+    (void)chip_select;
+    sim_check_idle("fill");
+    sim_transfer((uint64_t)tx_len * sim.frame_bits);
+    for (size_t i = 0; i < tx_len; i++)
+        sim_frame(*tx_buff);
+}
+
+void spi_handle_data_dma(spi_device_num_t spi_num, spi_chip_select_t chip_select, spi_data_t data, plic_interrupt_t *cb)
+{
+    (void)spi_num;
+    (void)chip_select;
+    sim_check_idle("DMA start");
+    sim.dma.active = 1;
+    sim.dma.buf = data.tx_buf;
+    sim.dma.len = data.tx_len;
+    sim.dma.callback = cb ? cb->callback : NULL;
+    sim.dma.ctx = cb ? cb->ctx : NULL;
+}
+
+void spi_sim_poll(void)
+{
+    plic_irq_callback_t callback = sim.dma.callback;
+
+    if (!sim.dma.active)
+        return;
+    /* The buffer is read only now, so a caller reusing it too early sends the wrong pixels */
+    sim.dma.active = 0;
+    sim_send(sim.dma.buf, sim.dma.len, SPI_TRANS_INT);
+    if (callback)
+        callback(sim.dma.ctx);
+}
+
+/* Only cycle deltas are taken, so the LCD model can do without a clock */
+__attribute__((weak)) uint64_t read_cycle(void)
+{
+    return 0;
+}
+
+void lcd_sim_set_clock(uint32_t hz)
+{
+    sim.clock = hz ? hz : LCD_SIM_DEFAULT_CLOCK;
+}
+
+void lcd_sim_set_transfer_overhead(uint32_t ns)
+{
+    sim.overhead_ns = ns;
+}
+
+void lcd_sim_get_stats(lcd_sim_stats_t *stats)
+{
+    *stats = sim.stats;
+}
+
+void lcd_sim_reset_stats(void)
+{
+    memset(&sim.stats, 0, sizeof(sim.stats));
+}
+
+void lcd_sim_get_size(uint16_t *width, uint16_t *height)
+{
+    *width = sim_width();
+    *height = sim_height();
+}
+
+uint16_t lcd_sim_get_pixel(uint16_t x, uint16_t y)
+{
+    if (x >= sim_width() || y >= sim_height())
+        return 0;
+    return sim.gram[y * SIM_SIDE + x];
+}
+
+int lcd_sim_dump_ppm(const char *path)
+{
+    uint16_t width = sim_width();
+    uint16_t height = sim_height();
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL)
+        return -1;
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    for (uint16_t y = 0; y < height; y++)
+    {
+        for (uint16_t x = 0; x < width; x++)
+        {
+            uint16_t p = sim.gram[y * SIM_SIDE + x];
+            uint8_t r5 = p >> 11, g6 = (p >> 5) & 0x3F, b5 = p & 0x1F;
+            uint8_t rgb[3] = {(r5 << 3) | (r5 >> 2), (g6 << 2) | (g6 >> 4), (b5 << 3) | (b5 >> 2)};
+
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+    return fclose(file);
+}
@@ -0,0 +1,178 @@
+#include "auto_exposure.h"
+#include "board_config.h"
+
+#if (BOARD_VERSION == BOARD_V1_2_LE)
+#include "ov2640.h"
+#define SENSOR_EXPOSURE_MAX OV2640_EXPOSURE_MAX
+#define SENSOR_GAIN_MAX OV2640_GAIN_MAX
+#define sensor_get_regs(camera) ov2640_get_regs()
+#define sensor_set_manual(camera, manual) ov2640_set_manual(manual)
+#define sensor_set_exposure(camera, lines) ov2640_set_exposure(lines)
+#define sensor_set_gain(camera, gain) ov2640_set_gain(gain)
+#define sensor_set_white_balance(camera, r, g, b) ov2640_set_white_balance(r, g, b)
+#elif (BOARD_VERSION == BOARD_V1_3)
+#include "gc0328.h"
+#define SENSOR_EXPOSURE_MAX GC0328_EXPOSURE_MAX
+#define SENSOR_GAIN_MAX GC0328_GAIN_MAX
+#define sensor_get_regs gc0328_get_regs
+#define sensor_set_manual gc0328_set_manual
+#define sensor_set_exposure gc0328_set_exposure
+#define sensor_set_gain gc0328_set_gain
+#define sensor_set_white_balance gc0328_set_white_balance
+#endif
+
+#define GAIN_UNITY 16
+#define WB_UNITY 64
+
+static uint32_t clamp(uint32_t value, uint32_t min, uint32_t max) {
+    return value < min ? min : value > max ? max : value;
+}
+
+void auto_exposure_init(auto_exposure_t* ae, uint8_t camera, uint8_t target) {
+    ae->camera = camera;
+    ae->target = target;
+    ae->exposure = SENSOR_EXPOSURE_MAX / 4;
+    ae->exposure_max = SENSOR_EXPOSURE_MAX;
+    ae->gain = GAIN_UNITY;
+    ae->gain_max = SENSOR_GAIN_MAX;
+    ae->wb_r = ae->wb_b = WB_UNITY;
+    ae->failed = 0;
+    ae->resend = 0;
+    ae->updates = 0;
+    ae->deferred = 0;
+    ae->rollbacks = 0;
+    sensor_bus_batch_init(&ae->batch, ae->ops, AUTO_EXPOSURE_OPS);
+
+    sensor_set_manual(camera, 1);
+    sensor_set_exposure(camera, ae->exposure);
+    sensor_set_gain(camera, ae->gain);
+    sensor_set_white_balance(camera, ae->wb_r, WB_UNITY, ae->wb_b);
+}
+
+void auto_exposure_deinit(auto_exposure_t* ae) {
+    sensor_set_manual(ae->camera, 0);
+}
+
+static int auto_exposure_step(auto_exposure_t* ae, const frame_stats_t* stats) {
+    uint32_t measured = stats->mean;
+    uint32_t lo = ae->target > AUTO_EXPOSURE_DEADBAND ? ae->target - AUTO_EXPOSURE_DEADBAND : 0;
+    uint32_t hi = (uint32_t)ae->target + AUTO_EXPOSURE_DEADBAND;
+    uint32_t total, wanted;
+    uint16_t exposure;
+    uint8_t gain;
+
+    /* A mean on target with burnt-out highlights is still too bright */
+    if (stats->bright * 20 > stats->samples && measured <= hi)
+        measured = hi + 1;
+    if (measured >= lo && measured <= hi)
+        return 0;
+
+    total = (uint32_t)ae->exposure * ae->gain;
+    wanted = total * ae->target / (measured ? measured : 1);
+    wanted = clamp(wanted, total / 4, total * 4);
+    total = (total + wanted) / 2;
+
+    exposure = clamp(total / GAIN_UNITY, 1, ae->exposure_max);
+    gain = clamp(total / exposure, GAIN_UNITY, ae->gain_max);
+    if (exposure == ae->exposure && gain == ae->gain)
+        return 0;
+
+    if (exposure != ae->exposure)
+        sensor_set_exposure(ae->camera, exposure);
+    if (gain != ae->gain)
+        sensor_set_gain(ae->camera, gain);
+    ae->exposure = exposure;
+    ae->gain = gain;
+    return 1;
+}
+
+static int auto_white_balance_step(auto_exposure_t* ae, const frame_stats_t* stats) {
+    uint8_t r, b;
+
+    if (!stats->mean_r || !stats->mean_g || !stats->mean_b)
+        return 0;
+
+    r = clamp((ae->wb_r + (uint32_t)ae->wb_r * stats->mean_g / stats->mean_r) / 2, WB_UNITY / 4, 255);
+    b = clamp((ae->wb_b + (uint32_t)ae->wb_b * stats->mean_g / stats->mean_b) / 2, WB_UNITY / 4, 255);
+    if ((r > ae->wb_r ? r - ae->wb_r : ae->wb_r - r) <= AUTO_EXPOSURE_WB_DEADBAND &&
+        (b > ae->wb_b ? b - ae->wb_b : ae->wb_b - b) <= AUTO_EXPOSURE_WB_DEADBAND)
+        return 0;
+
+    sensor_set_white_balance(ae->camera, r, WB_UNITY, b);
+    ae->wb_r = r;
+    ae->wb_b = b;
+    return 1;
+}
+
+/* Runs in interrupt context; the cache is repaired by the next update */
+static void auto_exposure_done(sensor_bus_batch_t* batch, void* ctx) {
+    auto_exposure_t* ae = ctx;
+
+    if (batch->state == SENSOR_BUS_FAILED)
+        ae->failed = 1;
+}
+
+static void auto_exposure_rollback(auto_exposure_t* ae) {
+    sensor_regs_t* regs = sensor_get_regs(ae->camera);
+    const sensor_bus_batch_t* batch = &ae->batch;
+    uint16_t i;
+
+    /*
+     * The ops from the failed one on never reached the sensor, or may have
+     * half reached it, but the cache took them as written. A lost page
+     * switch leaves the sensor on another bank than the cache thinks, so
+     * then nothing in it can be trusted. Otherwise they were all recorded
+     * after the last page switch, on the bank the batch left the cache on.
+     */
+    if (regs->bank != ae->batch_bank)
+        sensor_regs_invalidate(regs);
+    for (i = batch->done; i < batch->count; i++) {
+        if (batch->ops[i].reg == regs->config->bank_reg) {
+            sensor_regs_invalidate(regs);
+            break;
+        }
+    }
+    for (i = batch->done; i < batch->count; i++)
+        sensor_regs_forget(regs, batch->ops[i].reg);
+
+    ae->exposure = ae->last_exposure;
+    ae->gain = ae->last_gain;
+    ae->wb_r = ae->last_wb_r;
+    ae->wb_b = ae->last_wb_b;
+    ae->failed = 0;
+    ae->resend = 1;
+    ae->rollbacks++;
+}
+
+int auto_exposure_update(auto_exposure_t* ae, const frame_stats_t* stats) {
+    int changed;
+
+    /* Before begin empties the batch, which still holds the ops that failed */
+    if (ae->failed)
+        auto_exposure_rollback(ae);
+    /* The last update is still being written; this frame may not show it yet either */
+    if (sensor_bus_begin(&ae->batch) < 0) {
+        ae->deferred++;
+        return 0;
+    }
+    ae->last_exposure = ae->exposure;
+    ae->last_gain = ae->gain;
+    ae->last_wb_r = ae->wb_r;
+    ae->last_wb_b = ae->wb_b;
+
+    /* Part of the failed settings may have landed, so this frame sends all of the old ones again */
+    if (ae->resend) {
+        sensor_set_exposure(ae->camera, ae->exposure);
+        sensor_set_gain(ae->camera, ae->gain);
+        sensor_set_white_balance(ae->camera, ae->wb_r, WB_UNITY, ae->wb_b);
+        ae->resend = 0;
+        changed = 1;
+    } else {
+        changed = auto_exposure_step(ae, stats);
+        changed |= auto_white_balance_step(ae, stats);
+    }
+    ae->batch_bank = sensor_get_regs(ae->camera)->bank;
+    sensor_bus_end(auto_exposure_done, ae);
+    ae->updates += changed;
+    return changed;
+}
@@ -0,0 +1,67 @@
+#ifndef _AUTO_EXPOSURE_H_
+#define _AUTO_EXPOSURE_H_
+
+#include <stdint.h>
+#include "frame_stats.h"
+#include "sensor_bus.h"
+
+/* clang-format off */
+#define AUTO_EXPOSURE_TARGET    110
+/* Mean luma this close to the target needs no correction */
+#define AUTO_EXPOSURE_DEADBAND  8
+/* White balance gain steps smaller than this are not written */
+#define AUTO_EXPOSURE_WB_DEADBAND 2
+/* Register writes one update can queue before it has to wait for the bus */
+#define AUTO_EXPOSURE_OPS       12
+/* clang-format on */
+
+/*
+ * Software AE/AWB for one camera, driven by frame_stats of the captured
+ * frames instead of the sensor's own loops. Exposure and gain move half way
+ * towards the value that puts the mean luma on target, exposure first and
+ * gain once exposure is at its limit; many clipped highlights count as over
+ * target. White balance pulls the red and blue means to green (gray world).
+ * Nothing is written while the frame is within the deadbands, and what is
+ * written goes through the sensor register cache, so a settled scene costs
+ * no I2C traffic at all. The writes of an update are queued on the sensor
+ * bus and go out from interrupts while the caller moves on; an update that
+ * finds the previous one still on the bus is skipped. When a batch fails,
+ * the next update drops the registers it did not write from the cache,
+ * rolls the settings back to where they were before it and writes them
+ * again.
+ */
+typedef struct _auto_exposure {
+    uint8_t camera;
+    uint8_t target;
+    uint16_t exposure;
+    uint16_t exposure_max;
+    /* 16 is 1x */
+    uint8_t gain;
+    uint8_t gain_max;
+    /* 64 is 1x */
+    uint8_t wb_r;
+    uint8_t wb_b;
+    /* Settings before the batch on the bus, restored if it fails */
+    uint16_t last_exposure;
+    uint8_t last_gain;
+    uint8_t last_wb_r;
+    uint8_t last_wb_b;
+    /* Register bank the cache was left on by the batch */
+    uint8_t batch_bank;
+    volatile uint8_t failed;
+    uint8_t resend;
+    uint32_t updates;
+    uint32_t deferred;
+    uint32_t rollbacks;
+    sensor_bus_batch_t batch;
+    sensor_bus_op_t ops[AUTO_EXPOSURE_OPS];
+} auto_exposure_t;
+
+/* Take exposure control of the camera away from the sensor */
+void auto_exposure_init(auto_exposure_t* ae, uint8_t camera, uint8_t target);
+/* Hand control back to the sensor */
+void auto_exposure_deinit(auto_exposure_t* ae);
+/* Returns 1 when the sensor settings were changed */
+int auto_exposure_update(auto_exposure_t* ae, const frame_stats_t* stats);
+
+#endif
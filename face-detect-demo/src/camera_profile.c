@@ -0,0 +1,58 @@
+#include "camera_profile.h"
+#include "board_config.h"
+#include "dvp.h"
+#include "dvp_capture.h"
+#include <stddef.h>
+
+#if (BOARD_VERSION == BOARD_V1_2_LE)
+#include "ov2640.h"
+#define sensor_set_window ov2640_set_window
+#define sensor_set_frame_div ov2640_set_frame_div
+#elif (BOARD_VERSION == BOARD_V1_3)
+#include "gc0328.h"
+#define sensor_set_window gc0328_set_window
+#define sensor_set_frame_div gc0328_set_frame_div
+#endif
+
+const camera_profile_t camera_profile_qqvga = {
+    "QQVGA", 0, 0, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, CAMERA_VIEW_WIDTH / 2, CAMERA_VIEW_HEIGHT / 2, 1,
+};
+
+const camera_profile_t camera_profile_qvga = {
+    "QVGA", 0, 0, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, 1,
+};
+
+static camera_profile_t current = {
+    "QVGA", 0, 0, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, 1,
+};
+
+void camera_profile_roi(camera_profile_t* profile, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    profile->name = "ROI";
+    profile->x = x;
+    profile->y = y;
+    profile->width = profile->out_width = width;
+    profile->height = profile->out_height = height;
+    profile->frame_div = 1;
+}
+
+int camera_profile_apply(const camera_profile_t* profile) {
+    /* Claim the capture buffers first: that is the only step that can fail without touching the sensor */
+    if (dvp_capture_set_size(profile->out_width, profile->out_height) != 0)
+        return -1;
+    if (sensor_set_window(profile->x, profile->y, profile->width, profile->height, profile->out_width,
+                          profile->out_height) != 0 ||
+        sensor_set_frame_div(profile->frame_div) != 0) {
+        dvp_capture_set_size(current.out_width, current.out_height);
+        sensor_set_window(current.x, current.y, current.width, current.height, current.out_width,
+                          current.out_height);
+        return -1;
+    }
+
+    dvp_set_image_size(profile->out_width, profile->out_height);
+    current = *profile;
+    return 0;
+}
+
+const camera_profile_t* camera_profile_get(void) {
+    return &current;
+}
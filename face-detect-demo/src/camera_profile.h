@@ -0,0 +1,45 @@
+#ifndef _CAMERA_PROFILE_H_
+#define _CAMERA_PROFILE_H_
+
+#include <stdint.h>
+
+/* clang-format off */
+/* Coordinates profiles use: the sensor's whole field of view at QVGA scale */
+#define CAMERA_VIEW_WIDTH   320
+#define CAMERA_VIEW_HEIGHT  240
+/* clang-format on */
+
+/*
+ * A capture format: which part of the field of view the sensor reads out,
+ * the frame size it scales that window to, and how far the frame rate is
+ * divided down. What each sensor can scale is limited, see ov2640.h and
+ * gc0328.h.
+ */
+typedef struct _camera_profile {
+    const char* name;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint16_t out_width;
+    uint16_t out_height;
+    uint8_t frame_div;
+} camera_profile_t;
+
+/* The whole view at 160x120 and at 320x240, both at full rate */
+extern const camera_profile_t camera_profile_qqvga;
+extern const camera_profile_t camera_profile_qvga;
+
+/* A window of the view captured at its own scale and full rate */
+void camera_profile_roi(camera_profile_t* profile, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+/*
+ * Switch sensor, DVP and capture slots to the profile together. Capture must
+ * be stopped with every frame released, and restarted by the caller.
+ * Returns -1 and changes nothing when the profile does not fit the sensor or
+ * the capture buffers.
+ */
+int camera_profile_apply(const camera_profile_t* profile);
+/* The profile in effect; the sensor init tables start out at QVGA */
+const camera_profile_t* camera_profile_get(void);
+
+#endif
@@ -0,0 +1,406 @@
+#include "dvp_capture.h"
+#include "dvp.h"
+#include "encoding.h"
+#include "image_luma.h"
+#include "plic.h"
+#include "sysctl.h"
+#include <stddef.h>
+#include <string.h>
+
+static struct {
+    dvp_frame_t slot[DVP_CAPTURE_MAX_CAMERAS * DVP_CAPTURE_MAX_SLOTS];
+    /* Slots per ring; ring i holds slots i * slots to (i + 1) * slots - 1 */
+    uint8_t slots;
+    uint8_t rings;
+    dvp_capture_select_t select;
+    void* select_ctx;
+    uint8_t filling;
+    /* Pixels each slot was allocated for */
+    uint32_t capacity;
+    dvp_capture_format_t format;
+    uint8_t luma_step;
+    /* Camera whose outputs are on; frames are tagged with it at frame start */
+    volatile uint8_t camera;
+    /* A switch to target is queued and camera changes once it lands */
+    volatile uint8_t switching;
+    uint8_t target;
+    uint32_t sequence;
+    /* Sequence of the first frame the window covers since the stats were reset */
+    uint32_t window_start;
+    /* Finish timestamps of the latest frames, oldest overwritten first */
+    uint64_t finish[DVP_CAPTURE_WINDOW];
+    dvp_capture_stats_t stats;
+} capture;
+
+static unsigned long capture_lock(void) {
+    return clear_csr(mstatus, MSTATUS_MIE) & MSTATUS_MIE;
+}
+
+static void capture_unlock(unsigned long irq_state) {
+    set_csr(mstatus, irq_state);
+}
+
+static void capture_point_dvp(dvp_frame_t* frame) {
+    uint32_t plane = (uint32_t)frame->ai.width * frame->ai.height;
+
+    dvp_set_ai_addr((uint32_t)(uintptr_t)frame->ai.addr, (uint32_t)(uintptr_t)(frame->ai.addr + plane),
+                    (uint32_t)(uintptr_t)(frame->ai.addr + plane * 2));
+    dvp_set_display_addr((uint32_t)(uintptr_t)frame->display.addr);
+}
+
+static uint8_t capture_total_slots(void) {
+    return capture.slots * capture.rings;
+}
+
+/* A slot of the camera's ring to fill next: a free one, else its oldest unconsumed frame other than `done` */
+static dvp_frame_t* capture_take_slot(uint8_t camera, dvp_frame_t* done) {
+    uint8_t first = (capture.rings > 1 ? camera : 0) * capture.slots;
+    dvp_frame_t* oldest = NULL;
+
+    for (uint8_t i = first; i < first + capture.slots; i++) {
+        dvp_frame_t* frame = &capture.slot[i];
+
+        if (frame->state == DVP_SLOT_FREE)
+            return frame;
+        if (frame != done && frame->state == DVP_SLOT_READY && (!oldest || frame->sequence < oldest->sequence))
+            oldest = frame;
+    }
+    return oldest;
+}
+
+/* Ask for the switch to camera; it takes effect when dvp_capture_switched reports it */
+static int capture_request_switch(uint8_t camera) {
+    capture.target = camera;
+    capture.switching = 1;
+    if (capture.select(camera, capture.select_ctx) != 0) {
+        capture.switching = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Slot to fill after `done`, requesting a switch to the next camera when
+ * interleaving and it has room. The slot comes from the ring of the camera
+ * expected to deliver the next frame; should the switch land late, the frame
+ * is still tagged with the camera it really came from.
+ */
+static dvp_frame_t* capture_next_slot(dvp_frame_t* done) {
+    dvp_frame_t* next = NULL;
+
+    if (capture.rings > 1 && !capture.switching) {
+        uint8_t camera = (capture.camera + 1) % capture.rings;
+
+        next = capture_take_slot(camera, done);
+        if (next && capture_request_switch(camera) != 0) {
+            capture.stats.switch_deferred++;
+            next = NULL;
+        }
+    }
+    if (!next)
+        next = capture_take_slot(capture.switching ? capture.target : capture.camera, done);
+    /* Every other slot is owned: write over the frame just finished */
+    if (!next)
+        next = done;
+    if (next->state != DVP_SLOT_FREE) {
+        capture.stats.dropped++;
+        capture.stats.overwritten++;
+    }
+    return next;
+}
+
+static uint32_t cycles_to_us(uint64_t cycles) {
+    return cycles / (sysctl_clock_get_freq(SYSCTL_CLOCK_CPU) / 1000000);
+}
+
+static int capture_irq(void* ctx) {
+    uint64_t now = read_cycle();
+
+    (void)ctx;
+    if (dvp_get_interrupt(DVP_STS_FRAME_FINISH)) {
+        dvp_frame_t* done = &capture.slot[capture.filling];
+        dvp_frame_t* next;
+
+        dvp_clear_interrupt(DVP_STS_FRAME_FINISH);
+        done->finish_cycle = now;
+        done->sequence = capture.sequence++;
+        capture.finish[done->sequence % DVP_CAPTURE_WINDOW] = now;
+        capture.stats.captured++;
+        capture.stats.readout_us = cycles_to_us(now - done->start_cycle);
+        if (done->camera != capture.camera) {
+            /* The camera changed during readout, so the frame mixes both sensors */
+            done->state = DVP_SLOT_FREE;
+            capture.stats.dropped++;
+            capture.stats.switch_torn++;
+        } else {
+            done->state = DVP_SLOT_READY;
+            if (done->camera < DVP_CAPTURE_MAX_CAMERAS)
+                capture.stats.camera_frames[done->camera]++;
+        }
+
+        next = capture_next_slot(done);
+        next->state = DVP_SLOT_FILLING;
+        next->luma_ready = 0;
+        capture.filling = next->id;
+        capture_point_dvp(next);
+    } else {
+        dvp_frame_t* filling = &capture.slot[capture.filling];
+
+        dvp_clear_interrupt(DVP_STS_FRAME_START);
+        filling->start_cycle = now;
+        filling->camera = capture.camera;
+    }
+    return 0;
+}
+
+int dvp_capture_init(uint16_t width, uint16_t height, uint8_t slots) {
+    return dvp_capture_init_interleaved(width, height, slots, 1, NULL, NULL);
+}
+
+int dvp_capture_init_interleaved(uint16_t width, uint16_t height, uint8_t slots, uint8_t cameras,
+                                 dvp_capture_select_t select, void* ctx) {
+    if (slots < 2 || slots > DVP_CAPTURE_MAX_SLOTS)
+        return -1;
+    if (cameras < 1 || cameras > DVP_CAPTURE_MAX_CAMERAS || (cameras > 1 && !select))
+        return -1;
+
+    capture.slots = slots;
+    capture.rings = cameras;
+    capture.select = select;
+    capture.select_ctx = ctx;
+    capture.capacity = (uint32_t)width * height;
+    capture.format = DVP_CAPTURE_RGB;
+    capture.luma_step = 1;
+    for (uint8_t i = 0; i < capture_total_slots(); i++) {
+        dvp_frame_t* frame = &capture.slot[i];
+
+        frame->id = i;
+        frame->state = DVP_SLOT_FREE;
+        frame->ai.width = frame->display.width = width;
+        frame->ai.height = frame->display.height = height;
+        frame->ai.pixel = 3;
+        frame->ai.format = IMAGE_FORMAT_RGB_PLANAR;
+        frame->display.pixel = 2;
+        frame->display.format = IMAGE_FORMAT_RGB565;
+        frame->luma = frame->ai;
+        frame->luma.pixel = 1;
+        frame->luma.format = IMAGE_FORMAT_LUMA;
+        /* Allocated for the format and step that need it */
+        frame->luma.addr = NULL;
+        frame->luma_ready = 0;
+        if (image_init(&frame->ai) != 0 || image_init(&frame->display) != 0)
+            return -1;
+    }
+
+    plic_set_priority(IRQN_DVP_INTERRUPT, 1);
+    plic_irq_register(IRQN_DVP_INTERRUPT, capture_irq, NULL);
+    plic_irq_enable(IRQN_DVP_INTERRUPT);
+    return 0;
+}
+
+void dvp_capture_start(void) {
+    dvp_frame_t* first;
+
+    capture.switching = 0;
+    if (capture.rings > 1)
+        capture_request_switch(capture.camera);
+    first = capture_take_slot(capture.camera, NULL);
+    /* The consumers own the whole ring */
+    if (!first)
+        return;
+    first->state = DVP_SLOT_FILLING;
+    first->luma_ready = 0;
+    capture.filling = first->id;
+    capture_point_dvp(first);
+
+    dvp_clear_interrupt(DVP_STS_FRAME_START | DVP_STS_FRAME_FINISH);
+    dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 1);
+    /* The DVP starts converting on every frame start by itself from here on */
+    dvp_enable_auto();
+}
+
+void dvp_capture_stop(void) {
+    dvp_disable_auto();
+    dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 0);
+    for (uint8_t i = 0; i < capture_total_slots(); i++) {
+        if (capture.slot[i].state != DVP_SLOT_OWNED)
+            capture.slot[i].state = DVP_SLOT_FREE;
+    }
+}
+
+static int capture_any_owned(void) {
+    for (uint8_t i = 0; i < capture_total_slots(); i++) {
+        if (capture.slot[i].state == DVP_SLOT_OWNED)
+            return 1;
+    }
+    return 0;
+}
+
+static int capture_alloc_luma(dvp_frame_t* frame) {
+    if (frame->luma.addr)
+        return 0;
+    frame->luma.width = frame->ai.width / capture.luma_step;
+    frame->luma.height = frame->ai.height / capture.luma_step;
+    return image_init(&frame->luma);
+}
+
+/* Size the luma planes for the current frame size and step */
+static int capture_resize_luma(void) {
+    for (uint8_t i = 0; i < capture_total_slots(); i++) {
+        dvp_frame_t* frame = &capture.slot[i];
+
+        if (frame->luma.addr) {
+            image_deinit(&frame->luma);
+            frame->luma.addr = NULL;
+        }
+        if (capture.format == DVP_CAPTURE_LUMA && capture_alloc_luma(frame) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+int dvp_capture_set_size(uint16_t width, uint16_t height) {
+    if ((uint32_t)width * height > capture.capacity || capture_any_owned())
+        return -1;
+
+    for (uint8_t i = 0; i < capture_total_slots(); i++) {
+        dvp_frame_t* frame = &capture.slot[i];
+
+        frame->ai.width = frame->display.width = width;
+        frame->ai.height = frame->display.height = height;
+    }
+    return capture_resize_luma();
+}
+
+int dvp_capture_set_format(dvp_capture_format_t format, uint8_t luma_step) {
+    if (luma_step < 1 || luma_step > IMAGE_LUMA_MAX_STEP || capture_any_owned())
+        return -1;
+
+    capture.format = format;
+    capture.luma_step = luma_step;
+    dvp_set_output_enable(DVP_OUTPUT_AI, format == DVP_CAPTURE_RGB);
+    return capture_resize_luma();
+}
+
+const image_t* dvp_capture_luma(dvp_frame_t* frame) {
+    if (!frame->luma_ready) {
+        if (capture_alloc_luma(frame) != 0)
+            return NULL;
+        if (capture.format == DVP_CAPTURE_LUMA)
+            image_rgb565_to_luma(&frame->display, &frame->luma, capture.luma_step);
+        else
+            image_planar_to_luma(&frame->ai, &frame->luma, capture.luma_step);
+        frame->luma_ready = 1;
+    }
+    return &frame->luma;
+}
+
+void dvp_capture_set_camera(uint8_t camera) {
+    capture.camera = camera;
+}
+
+void dvp_capture_switched(uint8_t camera, int ok) {
+    if (!capture.switching || camera != capture.target)
+        return;
+    if (ok)
+        capture.camera = camera;
+    else
+        capture.stats.switch_deferred++;
+    capture.switching = 0;
+}
+
+dvp_frame_t* dvp_capture_acquire(int wait) {
+    return dvp_capture_acquire_camera(DVP_CAPTURE_ANY_CAMERA, wait);
+}
+
+dvp_frame_t* dvp_capture_acquire_camera(uint8_t camera, int wait) {
+    dvp_frame_t* newest;
+
+    do {
+        unsigned long irq_state = capture_lock();
+
+        newest = NULL;
+        for (uint8_t i = 0; i < capture_total_slots(); i++) {
+            dvp_frame_t* frame = &capture.slot[i];
+
+            if (frame->state == DVP_SLOT_READY && (camera == DVP_CAPTURE_ANY_CAMERA || frame->camera == camera) &&
+                (!newest || frame->sequence > newest->sequence))
+                newest = frame;
+        }
+        if (newest) {
+            /* Frames of this camera older than the one handed out will never be consumed */
+            for (uint8_t i = 0; i < capture_total_slots(); i++) {
+                dvp_frame_t* frame = &capture.slot[i];
+
+                if (frame->state == DVP_SLOT_READY && frame != newest && frame->camera == newest->camera) {
+                    frame->state = DVP_SLOT_FREE;
+                    capture.stats.dropped++;
+                }
+            }
+            newest->state = DVP_SLOT_OWNED;
+            capture.stats.consumed++;
+        }
+        capture_unlock(irq_state);
+    } while (!newest && wait);
+
+    if (newest) {
+        uint32_t latency_ms = cycles_to_us(read_cycle() - newest->finish_cycle) / 1000;
+        uint8_t bucket = 0;
+
+        while (bucket < DVP_CAPTURE_LATENCY_BUCKETS - 1 && latency_ms >= (1U << bucket))
+            bucket++;
+        capture.stats.latency_hist[bucket]++;
+    }
+    return newest;
+}
+
+void dvp_capture_release(dvp_frame_t* frame) {
+    unsigned long irq_state = capture_lock();
+
+    frame->state = DVP_SLOT_FREE;
+    capture_unlock(irq_state);
+}
+
+void dvp_capture_get_stats(dvp_capture_stats_t* stats) {
+    unsigned long irq_state = capture_lock();
+    uint32_t frames = capture.sequence - capture.window_start;
+    uint32_t last = capture.sequence - 1;
+
+    if (frames > DVP_CAPTURE_WINDOW)
+        frames = DVP_CAPTURE_WINDOW;
+    *stats = capture.stats;
+    stats->fps = 0;
+    stats->interval_min_us = UINT32_MAX;
+    stats->interval_max_us = 0;
+
+    /* Walk the window backwards from the newest finish timestamp */
+    for (uint32_t i = 1; i < frames; i++) {
+        uint64_t a = capture.finish[(last - i) % DVP_CAPTURE_WINDOW];
+        uint64_t b = capture.finish[(last - i + 1) % DVP_CAPTURE_WINDOW];
+        uint32_t interval = cycles_to_us(b - a);
+
+        if (interval < stats->interval_min_us)
+            stats->interval_min_us = interval;
+        if (interval > stats->interval_max_us)
+            stats->interval_max_us = interval;
+    }
+    if (frames > 1) {
+        uint64_t span = capture.finish[last % DVP_CAPTURE_WINDOW] -
+                        capture.finish[(last - frames + 1) % DVP_CAPTURE_WINDOW];
+
+        stats->fps = (float)(frames - 1) * sysctl_clock_get_freq(SYSCTL_CLOCK_CPU) / span;
+    } else {
+        stats->interval_min_us = 0;
+    }
+
+    capture_unlock(irq_state);
+}
+
+void dvp_capture_reset_stats(void) {
+    unsigned long irq_state = capture_lock();
+
+    memset(&capture.stats, 0, sizeof(capture.stats));
+    /* The sequence keeps counting, since it orders the frames still in the slots */
+    capture.window_start = capture.sequence;
+    capture_unlock(irq_state);
+}
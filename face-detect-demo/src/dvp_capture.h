@@ -0,0 +1,142 @@
+#ifndef _DVP_CAPTURE_H_
+#define _DVP_CAPTURE_H_
+
+#include <stdint.h>
+#include "image_process.h"
+
+/* clang-format off */
+#define DVP_CAPTURE_MAX_SLOTS   4
+/* Sensors interleaved capture alternates between, each with its own ring */
+#define DVP_CAPTURE_MAX_CAMERAS 2
+/* Camera argument of dvp_capture_acquire_camera taking frames of any camera */
+#define DVP_CAPTURE_ANY_CAMERA  0xFF
+/* Frame intervals kept for the rolling rate and jitter figures */
+#define DVP_CAPTURE_WINDOW      16
+/* Latency bucket i counts frames consumed less than 2^i ms after capture */
+#define DVP_CAPTURE_LATENCY_BUCKETS 8
+/* clang-format on */
+
+typedef enum _dvp_capture_format {
+    /* Planar RGB AI output and RGB565 display output */
+    DVP_CAPTURE_RGB,
+    /* Display output only; luma is derived from it */
+    DVP_CAPTURE_LUMA,
+} dvp_capture_format_t;
+
+typedef enum _dvp_slot_state {
+    DVP_SLOT_FREE,
+    DVP_SLOT_FILLING,
+    DVP_SLOT_READY,
+    DVP_SLOT_OWNED,
+} dvp_slot_state_t;
+
+/*
+ * One frame slot: both DVP outputs of the same sensor frame and where it came
+ * from. Timestamps are read_cycle() values at the frame-start and
+ * frame-finish interrupts. In DVP_CAPTURE_LUMA format ai is not written;
+ * luma is filled by dvp_capture_luma.
+ */
+typedef struct _dvp_frame {
+    uint8_t id;
+    volatile uint8_t state;
+    uint8_t camera;
+    uint32_t sequence;
+    uint64_t start_cycle;
+    uint64_t finish_cycle;
+    uint8_t luma_ready;
+    image_t ai;
+    image_t display;
+    image_t luma;
+} dvp_frame_t;
+
+typedef struct _dvp_capture_stats {
+    /* Frames the DVP completed */
+    uint32_t captured;
+    /* Completed frames that never reached a consumer */
+    uint32_t dropped;
+    /* Of those, frames written over because no slot was free */
+    uint32_t overwritten;
+    uint32_t consumed;
+    uint32_t camera_frames[DVP_CAPTURE_MAX_CAMERAS];
+    /* Interleaved camera switches put off because the sensor bus was busy, or that failed */
+    uint32_t switch_deferred;
+    /* Frames dropped because the camera changed while they were read out */
+    uint32_t switch_torn;
+    /* Over the last DVP_CAPTURE_WINDOW frames */
+    float fps;
+    uint32_t interval_min_us;
+    uint32_t interval_max_us;
+    /* Frame start to frame finish of the latest frame, i.e. sensor readout */
+    uint32_t readout_us;
+    uint32_t latency_hist[DVP_CAPTURE_LATENCY_BUCKETS];
+} dvp_capture_stats_t;
+
+/*
+ * Continuous capture into a ring of frame slots. The DVP runs in auto mode
+ * and the frame-finish interrupt publishes the slot it just filled and points
+ * the DVP at the next free one, so the sensor is never stopped. Consumers
+ * take the newest completed frame with dvp_capture_acquire, own it until
+ * dvp_capture_release, and older unconsumed frames are recycled. With every
+ * other slot owned the DVP keeps rewriting its current slot.
+ *
+ * Every frame carries a descriptor, and dvp_capture_get_stats reports the
+ * frame rate, interval jitter, capture-to-acquire latency and drops.
+ */
+/*
+ * Start routing the sensor output to the given camera, from the frame-finish
+ * interrupt. Returns nonzero if the switch cannot be queued right now;
+ * otherwise dvp_capture_switched must follow once it has landed or failed.
+ */
+typedef int (*dvp_capture_select_t)(uint8_t camera, void* ctx);
+
+/* Slots are allocated for width x height, the largest frame set_size accepts */
+int dvp_capture_init(uint16_t width, uint16_t height, uint8_t slots);
+/*
+ * Interleaved capture: every frame-finish interrupt with no switch in flight
+ * calls select for the next of `cameras` sensors, and each camera fills its
+ * own ring of `slots` slots, so one camera's consumer never recycles
+ * another's frames. A camera whose slots are all owned, or a refused or
+ * failed switch, keeps the current camera for one more frame. Frames are
+ * tagged with the camera whose switch had landed when they started.
+ */
+int dvp_capture_init_interleaved(uint16_t width, uint16_t height, uint8_t slots, uint8_t cameras,
+                                 dvp_capture_select_t select, void* ctx);
+void dvp_capture_start(void);
+void dvp_capture_stop(void);
+/*
+ * Describe the slots as width x height frames for the next start. Capture
+ * must be stopped with every frame released; the buffers are reused, so the
+ * frame may not exceed the size given to dvp_capture_init. The luma planes
+ * are sized for the frame, so they are allocated again.
+ */
+int dvp_capture_set_size(uint16_t width, uint16_t height);
+/*
+ * Capture format for the next start, with the luma plane at 1/luma_step of
+ * the frame size in both directions. DVP_CAPTURE_LUMA turns the AI output
+ * off, which saves the DVP three planes of memory writes per frame, for
+ * models that take one channel. Same conditions as dvp_capture_set_size.
+ * In DVP_CAPTURE_LUMA format the luma planes are allocated here, and -1
+ * is also returned when they do not fit in memory.
+ */
+int dvp_capture_set_format(dvp_capture_format_t format, uint8_t luma_step);
+/*
+ * The frame's luma plane, converted on the first call for an owned frame
+ * from the AI planes or, in DVP_CAPTURE_LUMA format, the display frame.
+ * In DVP_CAPTURE_RGB format the plane is allocated on first use, and NULL
+ * is returned when that fails.
+ */
+const image_t* dvp_capture_luma(dvp_frame_t* frame);
+/* Tag frames started from now on with this camera; with interleaving, the camera to start from */
+void dvp_capture_set_camera(uint8_t camera);
+/* From the select hook's completion, in any context: the switch to camera landed (ok) or failed */
+void dvp_capture_switched(uint8_t camera, int ok);
+/* Newest completed frame, or NULL when there is none and wait is 0 */
+dvp_frame_t* dvp_capture_acquire(int wait);
+/* The same restricted to frames tagged with camera; only that camera's older frames are dropped */
+dvp_frame_t* dvp_capture_acquire_camera(uint8_t camera, int wait);
+void dvp_capture_release(dvp_frame_t* frame);
+void dvp_capture_get_stats(dvp_capture_stats_t* stats);
+/* Start the counters and the frame rate window over, e.g. between measurements */
+void dvp_capture_reset_stats(void);
+
+#endif
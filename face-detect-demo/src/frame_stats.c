@@ -0,0 +1,57 @@
+#include "frame_stats.h"
+#include <string.h>
+
+void frame_stats_compute(frame_stats_t* stats, const image_t* frame, uint8_t step) {
+    uint32_t plane = (uint32_t)frame->width * frame->height;
+    const uint8_t* r = frame->addr;
+    const uint8_t* g = r + plane;
+    const uint8_t* b = g + plane;
+    int luma = frame->format == IMAGE_FORMAT_LUMA;
+    uint32_t sum = 0, sum_r = 0, sum_g = 0, sum_b = 0;
+    uint32_t lit = 0;
+    uint16_t row = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    for (uint16_t y = 0; y < frame->height; y += step, row++) {
+        uint32_t i = (uint32_t)y * frame->width + ((row & 1) ? step / 2 : 0);
+        uint32_t end = (uint32_t)(y + 1) * frame->width;
+
+        for (; i < end; i += step) {
+            uint8_t v = luma ? r[i] : (r[i] + 2 * g[i] + b[i]) >> 2;
+
+            stats->hist[v >> 2]++;
+            sum += v;
+            if (v <= FRAME_STATS_DARK) {
+                stats->dark++;
+            } else if (v >= FRAME_STATS_BRIGHT) {
+                stats->bright++;
+            } else if (!luma) {
+                sum_r += r[i];
+                sum_g += g[i];
+                sum_b += b[i];
+                lit++;
+            }
+            stats->samples++;
+        }
+    }
+
+    if (stats->samples)
+        stats->mean = sum / stats->samples;
+    if (lit) {
+        stats->mean_r = sum_r / lit;
+        stats->mean_g = sum_g / lit;
+        stats->mean_b = sum_b / lit;
+    }
+}
+
+uint8_t frame_stats_percentile(const frame_stats_t* stats, uint8_t percent) {
+    uint32_t target = stats->samples * percent / 100;
+    uint32_t count = 0;
+
+    for (uint8_t bin = 0; bin < FRAME_STATS_BINS; bin++) {
+        count += stats->hist[bin];
+        if (count > target)
+            return bin * 4 + 3;
+    }
+    return 255;
+}
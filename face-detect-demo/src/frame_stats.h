@@ -0,0 +1,37 @@
+#ifndef _FRAME_STATS_H_
+#define _FRAME_STATS_H_
+
+#include <stdint.h>
+#include "image_process.h"
+
+/* clang-format off */
+/* Luma histogram bins, four levels each */
+#define FRAME_STATS_BINS    64
+/* Samples at or beyond these levels count as clipped */
+#define FRAME_STATS_DARK    8
+#define FRAME_STATS_BRIGHT  247
+/* clang-format on */
+
+/*
+ * Exposure statistics of a planar AI frame from a sparse sample grid. Luma
+ * is (R + 2G + B) / 4. Channel means leave out clipped samples, whose color
+ * says nothing about the light. A luma image gives the same figures with
+ * the channel means left at 0.
+ */
+typedef struct _frame_stats {
+    uint32_t hist[FRAME_STATS_BINS];
+    uint32_t samples;
+    uint32_t dark;
+    uint32_t bright;
+    uint8_t mean;
+    uint8_t mean_r;
+    uint8_t mean_g;
+    uint8_t mean_b;
+} frame_stats_t;
+
+/* Sample every step-th pixel of every step-th row, odd sample rows shifted by step / 2 */
+void frame_stats_compute(frame_stats_t* stats, const image_t* frame, uint8_t step);
+/* Luma level below which the given percentage of samples falls, to bin resolution */
+uint8_t frame_stats_percentile(const frame_stats_t* stats, uint8_t percent);
+
+#endif
@@ -18,13 +18,20 @@
 
 #include "dvp.h"
 #include "fpioa.h"
+#include "gc0328.h"
 #include "i2c.h"
+#include "sensor_bus.h"
+#include "sensor_regs.h"
 #include "stdio.h"
 #include <unistd.h>
 
+/* The sensor bus queue only drives I2C0, so it relies on this */
 #define	ONE_I2C_CONTROL		1
 
 #define GC0328_ADDR                     0x42
+/* Sensor window rows and vertical blanking the init table sets up */
+#define GC0328_WINDOW_LINES             488
+#define GC0328_VBLANK                   0xB8
 static const uint8_t gc0328_config[][2] =
 {
     {0xFE, 0x80},   // [7] soft reset; [1:0] page select 00:REGF 01:REGF1
@@ -395,69 +402,152 @@ static uint8_t gc0328_rd_reg(uint8_t num, uint8_t reg)
     return data_buf;
 }
 
-void open_gc0328_0()
+/*
+ * Sensors are numbered by the route i2c_master_init selects. With one I2C
+ * controller both share bus 0 and the route is the SDA pin mux.
+ */
+#if	ONE_I2C_CONTROL
+#define GC0328_BUS(sensor)  0
+#else
+#define GC0328_BUS(sensor)  (sensor)
+#endif
+
+static sensor_regs_t gc0328_regs[2];
+static volatile int8_t gc0328_route = -1;
+
+/* The pad registers are system registers, reachable from every page */
+static const uint8_t gc0328_output_off[][2] =
+{
+    {0xF1, 0x00},
+    {0xF2, 0x00},
+    {0, 0}
+};
+
+static const uint8_t gc0328_output_on[][2] =
+{
+    {0xF1, 0x07},
+    {0xF2, 0x01},
+    {0, 0}
+};
+
+/* Output switches queued from the DVP interrupt */
+static sensor_bus_op_t gc0328_switch_ops[4];
+static sensor_bus_batch_t gc0328_switch;
+
+/*
+ * The sensor bus calls this from its interrupt between two transfers. The
+ * controller and SCLK are set up once by gc0328_init, so with one I2C
+ * controller a route change only moves SDA between the two pins, which is
+ * two pin mux writes and leaves the controller untouched. With two
+ * controllers the route is the controller, which the sensor bus does not
+ * drive, so only the blocking path gets there.
+ */
+static void gc0328_route_to(uint8_t sensor)
 {
+    if (gc0328_route == sensor)
+        return;
 #if	ONE_I2C_CONTROL
-    usleep(1 * 1000);
-    i2c_master_init(1);
-    usleep(1 * 1000);
-    gc0328_wr_reg(0, 0xFE, 0x00);
-    gc0328_wr_reg(0, 0xF1, 0x00);
-    gc0328_wr_reg(0, 0xF2, 0x00);
-    
-    usleep(1 * 1000);
-    i2c_master_init(0);
-    usleep(1 * 1000);
-    gc0328_wr_reg(0, 0xFE, 0x00);
-    gc0328_wr_reg(0, 0xF1, 0x07);
-    gc0328_wr_reg(0, 0xF2, 0x01);
+    fpioa_set_function(sensor ? DVP_SCCB_SDA_PIN_2 : DVP_SCCB_SDA_PIN, FUNC_RESV0);
+    fpioa_set_function(sensor ? DVP_SCCB_SDA_PIN : DVP_SCCB_SDA_PIN_2, FUNC_I2C0_SDA);
 #else
-    usleep(1 * 1000);
-    i2c_master_init(1);
-    usleep(1 * 1000);
-    gc0328_wr_reg(1, 0xFE, 0x00);
-    gc0328_wr_reg(1, 0xF1, 0x00);
-    gc0328_wr_reg(1, 0xF2, 0x00);
-    
-    usleep(1 * 1000);
-    i2c_master_init(0);
-    usleep(1 * 1000);
-    gc0328_wr_reg(0, 0xFE, 0x00);
-    gc0328_wr_reg(0, 0xF1, 0x07);
-    gc0328_wr_reg(0, 0xF2, 0x01);
+    i2c_master_init(sensor);
 #endif
+    gc0328_route = sensor;
 }
 
-void open_gc0328_1()
+static const sensor_bus_config_t gc0328_bus_config =
 {
-#if	ONE_I2C_CONTROL
-	//usleep(1 * 1000);
-	i2c_master_init(0);
-	//usleep(1 * 1000);
-	gc0328_wr_reg(0, 0xFE, 0x00);
-	gc0328_wr_reg(0, 0xF1, 0x00);
-	gc0328_wr_reg(0, 0xF2, 0x00);
-	usleep(1 * 1000);
-	i2c_master_init(1);
-	//usleep(1 * 1000);
-	gc0328_wr_reg(0, 0xFE, 0x00);
-	gc0328_wr_reg(0, 0xF1, 0x07);
-	gc0328_wr_reg(0, 0xF2, 0x01);
+    .address = GC0328_ADDR,
+    .select = gc0328_route_to,
+};
 
-#else
-    usleep(1 * 1000);
-    i2c_master_init(0);
-    usleep(1 * 1000);
-    gc0328_wr_reg(0, 0xFE, 0x00);
-    gc0328_wr_reg(0, 0xF1, 0x00);
-    gc0328_wr_reg(0, 0xF2, 0x00);
-    usleep(1 * 1000);
-    i2c_master_init(1);
+static void gc0328_select(uint8_t sensor)
+{
+    if (gc0328_route == sensor)
+        return;
+    gc0328_route_to(sensor);
     usleep(1 * 1000);
-    gc0328_wr_reg(1, 0xFE, 0x00);
-    gc0328_wr_reg(1, 0xF1, 0x07);
-    gc0328_wr_reg(1, 0xF2, 0x01);
-#endif	
+}
+
+static void gc0328_regs_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    uint8_t sensor = (uintptr_t)ctx;
+
+    if (sensor_bus_record(sensor, reg, value) == 0)
+        return;
+    sensor_bus_lock();
+    gc0328_select(sensor);
+    gc0328_wr_reg(GC0328_BUS(sensor), reg, value);
+    sensor_bus_unlock();
+}
+
+static uint8_t gc0328_regs_read(void *ctx, uint8_t reg)
+{
+    uint8_t sensor = (uintptr_t)ctx;
+    uint8_t value;
+
+    /* Writes recorded so far must reach the sensor before this read */
+    sensor_bus_flush();
+    sensor_bus_lock();
+    gc0328_select(sensor);
+    value = gc0328_rd_reg(GC0328_BUS(sensor), reg);
+    sensor_bus_unlock();
+    return value;
+}
+
+/* The clock enable is written repeatedly while the PLL settles, 0x4D/0x4E is
+ * the AWB table window and 0x4F latches it. The pad enables are shared by
+ * all pages and also switched from the DVP interrupt. */
+static const uint8_t gc0328_ports[] = {0xFC, 0x4E, 0x4F, 0xF1, 0xF2};
+
+/* 0xFE[1:0] selects the page and 0xFE[7] soft-resets */
+static const sensor_regs_config_t gc0328_regs_config = {
+    .bank_reg = 0xFE,
+    .bank_mask = 0x03,
+    .reset_bank = 0,
+    .reset_reg = 0xFE,
+    .reset_mask = 0x80,
+    .port_count = sizeof(gc0328_ports),
+    .ports = gc0328_ports,
+    .write = gc0328_regs_write,
+    .read = gc0328_regs_read,
+};
+
+/* Only the pad enables differ between the two camera selections, so a switch
+ * costs four writes, verified or not. */
+static void gc0328_open(uint8_t on, uint8_t off, int flags)
+{
+    sensor_regs_apply(&gc0328_regs[off], gc0328_output_off, flags);
+    sensor_regs_apply(&gc0328_regs[on], gc0328_output_on, flags);
+}
+
+/* The pad writes change no page, so they may cut in between the ops of
+ * another batch. They bypass the cache, which never holds ports anyway. */
+int gc0328_select_output(uint8_t sensor, sensor_bus_done_t done, void *ctx)
+{
+    if (sensor_bus_locked() || sensor_bus_pending(&gc0328_switch))
+        return -1;
+    sensor_bus_batch_init(&gc0328_switch, gc0328_switch_ops, 4);
+    for (uint8_t i = 0; gc0328_output_off[i][0]; i++)
+        sensor_bus_add_write(&gc0328_switch, !sensor, gc0328_output_off[i][0], gc0328_output_off[i][1]);
+    for (uint8_t i = 0; gc0328_output_on[i][0]; i++)
+        sensor_bus_add_write(&gc0328_switch, sensor, gc0328_output_on[i][0], gc0328_output_on[i][1]);
+    return sensor_bus_submit(&gc0328_switch, done, ctx, 1);
+}
+
+void open_gc0328_0()
+{
+    gc0328_open(0, 1, SENSOR_REGS_VERIFY);
+}
+
+void open_gc0328_1()
+{
+    gc0328_open(1, 0, SENSOR_REGS_VERIFY);
+}
+
+sensor_regs_t *gc0328_get_regs(uint8_t sensor)
+{
+    return &gc0328_regs[sensor];
 }
 
 int gc0328_read_id(uint8_t num, uint8_t *id)
@@ -469,31 +559,135 @@ int gc0328_read_id(uint8_t num, uint8_t *id)
 int gc0328_init(void)
 {
     uint8_t data;
-    uint32_t i;
-    uint8_t num = 0;
-    i2c_master_init(num);
-    gc0328_read_id(num, &data);
-    printf("gc0328 0 ID : 0x%x\n", data);
 
-    for (i = 0; gc0328_config[i][0]; i++)
+    i2c_master_init(0);
+    gc0328_route = 0;
+    usleep(1 * 1000);
+    sensor_bus_init(&gc0328_bus_config);
+    sensor_bus_batch_init(&gc0328_switch, gc0328_switch_ops, 4);
+    for (uint8_t sensor = 0; sensor < 2; sensor++)
     {
-        gc0328_wr_reg(num, gc0328_config[i][0], gc0328_config[i][1]);
+        sensor_regs_init(&gc0328_regs[sensor], &gc0328_regs_config, (void *)(uintptr_t)sensor);
+        gc0328_select(sensor);
+        gc0328_read_id(GC0328_BUS(sensor), &data);
+        printf("gc0328 %u ID : 0x%x\n", sensor, data);
+        /* The vendor sequence goes out as written, repeats included; it is not
+         * verified, since it resets the sensor and writes self-clearing bits */
+        sensor_regs_apply(&gc0328_regs[sensor], gc0328_config, SENSOR_REGS_FORCE);
     }
-    usleep(1 * 1000);
-#if	ONE_I2C_CONTROL	
-    num = 0;
-	i2c_master_init(1);
-	gc0328_read_id(num, &data);
-#else
-    num = 1;
-    i2c_master_init(num);
-    gc0328_read_id(num, &data);
-#endif	
-    printf("gc0328 1 ID : 0x%x\n", data);
-    for (i = 0; gc0328_config[i][0]; i++)
+    return 0;
+}
+
+int gc0328_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t out_width,
+                      uint16_t out_height)
+{
+    uint8_t subsample;
+
+    if (x + width > GC0328_VIEW_WIDTH || y + height > GC0328_VIEW_HEIGHT)
+        return -1;
+    /* The subsampler only divides by whole ratios: 1/2 gives the view at full scale, 1/4 at half */
+    if (out_width == width && out_height == height)
     {
-        gc0328_wr_reg(num, gc0328_config[i][0], gc0328_config[i][1]);
+        subsample = 0x22;
     }
+    else if (out_width * 2 == width && out_height * 2 == height)
+    {
+        subsample = 0x44;
+        x /= 2;
+        y /= 2;
+    }
+    else
+    {
+        return -1;
+    }
+
+    const uint8_t window[][2] =
+    {
+        {0xFE, 0x00},
+        {0x59, subsample},
+        {0x51, (y >> 8) & 0x01},
+        {0x52, y & 0xFF},
+        {0x53, (x >> 8) & 0x03},
+        {0x54, x & 0xFF},
+        {0x55, (out_height >> 8) & 0x01},
+        {0x56, out_height & 0xFF},
+        {0x57, (out_width >> 8) & 0x03},
+        {0x58, out_width & 0xFF},
+        {0, 0}
+    };
+
+    for (uint8_t sensor = 0; sensor < 2; sensor++)
+        sensor_regs_apply(&gc0328_regs[sensor], window, 0);
+    return 0;
+}
+
+int gc0328_set_frame_div(uint8_t div)
+{
+    /* Stretch vertical blanking so a frame takes div times the init table's frame time */
+    uint16_t vblank = (GC0328_WINDOW_LINES + GC0328_VBLANK) * div - GC0328_WINDOW_LINES;
+
+    if (div < 1 || vblank > 0x0FFF)
+        return -1;
+
+    const uint8_t blanking[][2] =
+    {
+        {0xFE, 0x00},
+        {0x07, (vblank >> 8) & 0x0F},
+        {0x08, vblank & 0xFF},
+        {0, 0}
+    };
+
+    for (uint8_t sensor = 0; sensor < 2; sensor++)
+        sensor_regs_apply(&gc0328_regs[sensor], blanking, 0);
+    return 0;
+}
+
+int gc0328_set_manual(uint8_t sensor, int manual)
+{
+    sensor_regs_t *regs = &gc0328_regs[sensor];
+
+    /* Whoever ran the loop so far, the cached gain and exposure may be stale */
+    sensor_regs_write(regs, 0xFE, 0x00, 0);
+    sensor_regs_forget(regs, 0x03);
+    sensor_regs_forget(regs, 0x04);
+    sensor_regs_forget(regs, 0x70);
+    sensor_regs_forget(regs, 0x77);
+    sensor_regs_forget(regs, 0x78);
+    sensor_regs_forget(regs, 0x79);
+    /* 0x4F[0] is AEC, 0x42[1] AWB */
+    sensor_regs_update(regs, 0x4F, 0x01, manual ? 0x00 : 0x01, 0);
+    sensor_regs_update(regs, 0x42, 0x02, manual ? 0x00 : 0x02, 0);
+    return 0;
+}
+
+int gc0328_set_exposure(uint8_t sensor, uint16_t lines)
+{
+    sensor_regs_t *regs = &gc0328_regs[sensor];
+
+    sensor_regs_write(regs, 0xFE, 0x00, 0);
+    sensor_regs_update(regs, 0x03, 0x0F, lines >> 8, 0);
+    sensor_regs_write(regs, 0x04, lines & 0xFF, 0);
+    return 0;
+}
+
+int gc0328_set_gain(uint8_t sensor, uint8_t gain)
+{
+    /* Global gain is 0x40 for 1x */
+    uint8_t value = (gain > GC0328_GAIN_MAX ? GC0328_GAIN_MAX : gain) * 4;
+
+    sensor_regs_write(&gc0328_regs[sensor], 0xFE, 0x00, 0);
+    sensor_regs_write(&gc0328_regs[sensor], 0x70, value, 0);
+    return 0;
+}
+
+int gc0328_set_white_balance(uint8_t sensor, uint8_t r, uint8_t g, uint8_t b)
+{
+    sensor_regs_t *regs = &gc0328_regs[sensor];
+
+    sensor_regs_write(regs, 0xFE, 0x00, 0);
+    sensor_regs_write(regs, 0x77, r, 0);
+    sensor_regs_write(regs, 0x78, g, 0);
+    sensor_regs_write(regs, 0x79, b, 0);
     return 0;
 }
 
@@ -501,8 +695,10 @@ uint8_t gc0328_read_luma(void)
 {
 	uint8_t luma;
 	
-	gc0328_wr_reg(0, 0xfe, 0x1);
-	luma = gc0328_rd_reg(0, 0x14);
+	uint8_t sensor = gc0328_route < 0 ? 0 : gc0328_route;
+
+	sensor_regs_write(&gc0328_regs[sensor], 0xfe, 0x1, 0);
+	luma = gc0328_regs_read((void *)(uintptr_t)sensor, 0x14);
 
 	return luma;
 }
@@ -512,11 +708,12 @@ uint16_t gc0328_exposure_time(void)
 	uint8_t exp11_8;
 	uint8_t exp7_0;
 	uint16_t exp = 0;
+	uint8_t sensor = gc0328_route < 0 ? 0 : gc0328_route;
 
-	gc0328_wr_reg(0, 0xfe, 0x0);
+	sensor_regs_write(&gc0328_regs[sensor], 0xfe, 0x0, 0);
 	
-	exp11_8 = gc0328_rd_reg(0, 0x03);
-	exp7_0  = gc0328_rd_reg(0, 0x04);
+	exp11_8 = gc0328_regs_read((void *)(uintptr_t)sensor, 0x03);
+	exp7_0  = gc0328_regs_read((void *)(uintptr_t)sensor, 0x04);
 
 	exp = (exp11_8<<8) | exp7_0;
 	return exp;
@@ -15,8 +15,48 @@
 #ifndef __GC0328_H__
 #define __GC0328_H__
 
+#include <stdint.h>
+#include "sensor_bus.h"
+#include "sensor_regs.h"
+
+/* Coordinates of gc0328_set_window: the sensor window subsampled by 2 */
+#define GC0328_VIEW_WIDTH   320
+#define GC0328_VIEW_HEIGHT  240
+/* Longest exposure in lines that still fits the init table's frame */
+#define GC0328_EXPOSURE_MAX 0x290
+/* Highest gain of gc0328_set_gain (16 = 1x): global gain 0x70 tops out at 0xFF, about 4x */
+#define GC0328_GAIN_MAX     (0xFF / 4)
+
 int gc0328_init(void);
 void open_gc0328_0();
 void open_gc0328_1();
+/*
+ * Enable one sensor's outputs and disable the other's without read-back,
+ * for switching between frames from the DVP interrupt. The writes are
+ * queued ahead of everything else on the sensor bus and finish within a
+ * few transfers; done runs from the bus interrupt once they have landed or
+ * failed. Returns -1, and done never runs, while a blocking transfer holds
+ * the bus or the previous switch is still being written.
+ */
+int gc0328_select_output(uint8_t sensor, sensor_bus_done_t done, void *ctx);
+/*
+ * Crop both sensors to x, y, width, height of the field of view, delivered
+ * at full scale (out == window) or half scale (out == window / 2).
+ */
+int gc0328_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t out_width,
+                      uint16_t out_height);
+/* Run both sensors at 1/div of their full frame rate */
+int gc0328_set_frame_div(uint8_t div);
+/*
+ * Manual exposure for a software control loop: with manual set the sensor's
+ * AEC and AWB stop and the values below take effect. Gain is 16 for 1x,
+ * white balance gains 64 for 1x.
+ */
+int gc0328_set_manual(uint8_t sensor, int manual);
+int gc0328_set_exposure(uint8_t sensor, uint16_t lines);
+int gc0328_set_gain(uint8_t sensor, uint8_t gain);
+int gc0328_set_white_balance(uint8_t sensor, uint8_t r, uint8_t g, uint8_t b);
+/* Register cache of the sensor on route 0 or 1 */
+sensor_regs_t *gc0328_get_regs(uint8_t sensor);
 
 #endif
@@ -0,0 +1,163 @@
+#include "image_luma.h"
+
+#define LANE16_LO 0x0000FFFF0000FFFFULL
+#define LANE8_LO 0x00FF00FF00FF00FFULL
+#define LANE16(x) ((x) * 0x0001000100010001ULL)
+
+/* Pixel i of a display frame lives in the other halfword of its 32-bit word */
+#define GRAM_PIXEL(gram, i) (((const uint16_t*)(gram))[(i) ^ 1])
+
+/* Swap the two halfwords of each 32-bit word: display order <-> pixel order */
+static inline uint64_t swap_halves(uint64_t v) {
+    return ((v >> 16) & LANE16_LO) | ((v & LANE16_LO) << 16);
+}
+
+/* Four 16-bit lanes holding bytes -> four packed bytes, lane 0 first */
+static inline uint32_t pack_lanes(uint64_t v) {
+    v = (v | (v >> 8)) & LANE16_LO;
+    return (uint32_t)(v | (v >> 16));
+}
+
+/* Four packed bytes -> four 16-bit lanes, byte 0 in lane 0 */
+static inline uint64_t unpack_lanes(uint32_t x) {
+    uint64_t v = x;
+
+    v = (v | (v << 16)) & LANE16_LO;
+    return (v | (v << 8)) & LANE8_LO;
+}
+
+/* 5/6-bit lanes -> 8-bit lanes, masking off what the right shift pulls in from the next lane */
+static inline uint64_t expand5(uint64_t v) {
+    return (v << 3) | ((v >> 2) & LANE16(0x07));
+}
+
+static inline uint64_t expand6(uint64_t v) {
+    return (v << 2) | ((v >> 4) & LANE16(0x03));
+}
+
+static inline int is_aligned(const void* p, uintptr_t bytes) {
+    return ((uintptr_t)p & (bytes - 1)) == 0;
+}
+
+/* The weights sum to 256, so a lane of 8-bit inputs never carries into the next */
+static inline uint32_t luma_weigh(uint32_t r, uint32_t g, uint32_t b) {
+    return r * 77 + g * 150 + b * 29;
+}
+
+static inline void rgb565_expand(uint16_t p, uint32_t* r, uint32_t* g, uint32_t* b) {
+    uint8_t r5 = p >> 11, g6 = (p >> 5) & 0x3F, b5 = p & 0x1F;
+
+    *r = (r5 << 3) | (r5 >> 2);
+    *g = (g6 << 2) | (g6 >> 4);
+    *b = (b5 << 3) | (b5 >> 2);
+}
+
+static int luma_prepare(const image_t* src, image_t* dst, uint8_t step) {
+    if (step < 1 || step > IMAGE_LUMA_MAX_STEP)
+        return -1;
+    dst->width = src->width / step;
+    dst->height = src->height / step;
+    dst->pixel = 1;
+    dst->format = IMAGE_FORMAT_LUMA;
+    return 0;
+}
+
+int image_planar_to_luma(const image_t* src, image_t* dst, uint8_t step) {
+    uint32_t plane = (uint32_t)src->width * src->height;
+    const uint8_t* r = src->addr;
+    const uint8_t* g = r + plane;
+    const uint8_t* b = g + plane;
+    uint8_t* y = dst->addr;
+    uint32_t boxes = step * step;
+
+    if (luma_prepare(src, dst, step) != 0)
+        return -1;
+
+    if (step == 1) {
+        uint32_t i = 0;
+
+        if (is_aligned(r, 4) && is_aligned(g, 4) && is_aligned(b, 4) && is_aligned(y, 4)) {
+            for (; i + 4 <= plane; i += 4) {
+                uint64_t v = unpack_lanes(*(const uint32_t*)(r + i)) * 77 +
+                             unpack_lanes(*(const uint32_t*)(g + i)) * 150 +
+                             unpack_lanes(*(const uint32_t*)(b + i)) * 29;
+
+                *(uint32_t*)(y + i) = pack_lanes((v >> 8) & LANE16(0xFF));
+            }
+        }
+        for (; i < plane; i++)
+            y[i] = luma_weigh(r[i], g[i], b[i]) >> 8;
+        return 0;
+    }
+
+    for (uint16_t dy = 0; dy < dst->height; dy++) {
+        for (uint16_t dx = 0; dx < dst->width; dx++) {
+            uint32_t sr = 0, sg = 0, sb = 0;
+
+            for (uint8_t j = 0; j < step; j++) {
+                uint32_t i = ((uint32_t)dy * step + j) * src->width + dx * step;
+
+                for (uint8_t k = 0; k < step; k++, i++) {
+                    sr += r[i];
+                    sg += g[i];
+                    sb += b[i];
+                }
+            }
+            *y++ = luma_weigh(sr, sg, sb) / boxes >> 8;
+        }
+    }
+    return 0;
+}
+
+int image_rgb565_to_luma(const image_t* src, image_t* dst, uint8_t step) {
+    uint32_t pixels = (uint32_t)src->width * src->height;
+    const uint32_t* gram = (const uint32_t*)src->addr;
+    uint8_t* y = dst->addr;
+    uint32_t boxes = step * step;
+
+    if (luma_prepare(src, dst, step) != 0)
+        return -1;
+
+    if (step == 1) {
+        uint32_t i = 0;
+
+        if (is_aligned(gram, 8) && is_aligned(y, 4)) {
+            const uint64_t* word = (const uint64_t*)gram;
+
+            for (; i + 4 <= pixels; i += 4) {
+                uint64_t v = swap_halves(*word++);
+                uint64_t r8 = expand5((v >> 11) & LANE16(0x1F));
+                uint64_t g8 = expand6((v >> 5) & LANE16(0x3F));
+                uint64_t b8 = expand5(v & LANE16(0x1F));
+
+                *(uint32_t*)(y + i) = pack_lanes(((r8 * 77 + g8 * 150 + b8 * 29) >> 8) & LANE16(0xFF));
+            }
+        }
+        for (; i < pixels; i++) {
+            uint32_t r, g, b;
+
+            rgb565_expand(GRAM_PIXEL(gram, i), &r, &g, &b);
+            y[i] = luma_weigh(r, g, b) >> 8;
+        }
+        return 0;
+    }
+
+    for (uint16_t dy = 0; dy < dst->height; dy++) {
+        for (uint16_t dx = 0; dx < dst->width; dx++) {
+            uint32_t sum = 0;
+
+            for (uint8_t j = 0; j < step; j++) {
+                uint32_t i = ((uint32_t)dy * step + j) * src->width + dx * step;
+
+                for (uint8_t k = 0; k < step; k++, i++) {
+                    uint32_t r, g, b;
+
+                    rgb565_expand(GRAM_PIXEL(gram, i), &r, &g, &b);
+                    sum += luma_weigh(r, g, b);
+                }
+            }
+            *y++ = sum / boxes >> 8;
+        }
+    }
+    return 0;
+}
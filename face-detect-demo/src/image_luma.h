@@ -0,0 +1,23 @@
+#ifndef _IMAGE_LUMA_H_
+#define _IMAGE_LUMA_H_
+
+#include <stdint.h>
+#include "image_process.h"
+
+/* clang-format off */
+#define IMAGE_LUMA_MAX_STEP 4
+/* clang-format on */
+
+/*
+ * Single-channel input for grayscale models, Y = (77R + 150G + 29B) / 256
+ * (BT.601). dst becomes an IMAGE_FORMAT_LUMA image of src->width / step x
+ * src->height / step, each sample the mean of a step x step box, and its
+ * buffer must hold that many bytes. At step 1 both kernels handle four
+ * pixels per 64-bit word when the buffers are aligned.
+ */
+/* From the planar AI output */
+int image_planar_to_luma(const image_t* src, image_t* dst, uint8_t step);
+/* From the RGB565 display output, for capture without the AI output */
+int image_rgb565_to_luma(const image_t* src, image_t* dst, uint8_t step);
+
+#endif
@@ -17,6 +17,11 @@
 
 #include <stdint.h>
 
+/* image_t.format; pixel is the bytes per pixel of the format */
+#define IMAGE_FORMAT_RGB_PLANAR 0   /* R, G and B planes, pixel 3 */
+#define IMAGE_FORMAT_RGB565     1   /* LCD word order, pixel 2 */
+#define IMAGE_FORMAT_LUMA       2   /* one Y plane, pixel 1 */
+
 typedef struct
 {
     uint8_t *addr;
@@ -16,7 +16,7 @@
 #include <unistd.h>
 #include "lcd.h"
 #include "nt35310.h"
-#include "font.h"
+#include "lcd_font.h"
 #include "board_config.h"
 
 static lcd_ctl_t lcd_ctl;
@@ -43,9 +43,8 @@ void lcd_init(void)
     tft_write_command(SLEEP_OFF);
     usleep(100000);
     /*pixel format*/
-    tft_write_command(PIXEL_FORMAT_SET);
     data = 0x55;
-    tft_write_byte(&data, 1);
+    tft_write_command_data(PIXEL_FORMAT_SET, &data, 1);
     lcd_set_direction(DIR_XY_LRUD);
 
     /*display on*/
@@ -67,29 +66,27 @@ void lcd_set_direction(lcd_dir_t dir)
         lcd_ctl.height = LCD_Y_MAX - 1;
     }
 
-    tft_write_command(MEMORY_ACCESS_CTL);
-    tft_write_byte((uint8_t *)&dir, 1);
+    tft_write_command_data(MEMORY_ACCESS_CTL, (uint8_t *)&dir, 1);
 }
 
-void lcd_set_area(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+void lcd_get_size(uint16_t *width, uint16_t *height)
 {
-    uint8_t data[4] = {0};
-
-    data[0] = (uint8_t)(x1 >> 8);
-    data[1] = (uint8_t)(x1);
-    data[2] = (uint8_t)(x2 >> 8);
-    data[3] = (uint8_t)(x2);
-    tft_write_command(HORIZONTAL_ADDRESS_SET);
-    tft_write_byte(data, 4);
+    *width = lcd_ctl.width + 1;
+    *height = lcd_ctl.height + 1;
+}
 
-    data[0] = (uint8_t)(y1 >> 8);
-    data[1] = (uint8_t)(y1);
-    data[2] = (uint8_t)(y2 >> 8);
-    data[3] = (uint8_t)(y2);
-    tft_write_command(VERTICAL_ADDRESS_SET);
-    tft_write_byte(data, 4);
+void lcd_set_area(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    uint8_t x[4] = {(uint8_t)(x1 >> 8), (uint8_t)x1, (uint8_t)(x2 >> 8), (uint8_t)x2};
+    uint8_t y[4] = {(uint8_t)(y1 >> 8), (uint8_t)y1, (uint8_t)(y2 >> 8), (uint8_t)y2};
+    const tft_command_t area[] =
+    {
+        {HORIZONTAL_ADDRESS_SET, x, 4},
+        {VERTICAL_ADDRESS_SET, y, 4},
+        {MEMORY_WRITE, NULL, 0},
+    };
 
-    tft_write_command(MEMORY_WRITE);
+    tft_write_commands(area, 3);
 }
 
 void lcd_draw_point(uint16_t x, uint16_t y, uint16_t color)
@@ -98,108 +95,137 @@ void lcd_draw_point(uint16_t x, uint16_t y, uint16_t color)
     tft_write_half(&color, 1);
 }
 
-void lcd_draw_char(uint16_t x, uint16_t y, char c, uint16_t color)
+/* Rasterize count glyphs as one strip, each glyph row packed as 4 GRAM words */
+static void lcd_ram_draw_text(const char *str, uint32_t count, uint32_t *ptr, uint16_t font_color, uint16_t bg_color)
 {
-    uint8_t i = 0;
-    uint8_t j = 0;
+    uint32_t lut[4];
+    uint32_t width = 4 * count;
+    const uint8_t *pdata = NULL;
+    uint32_t *pixel = NULL;
     uint8_t data = 0;
 
-    for (i = 0; i < 16; i++)
+    /* Two font bits -> one word, left pixel in the upper halfword */
+    lut[0] = ((uint32_t)bg_color << 16) | bg_color;
+    lut[1] = ((uint32_t)bg_color << 16) | font_color;
+    lut[2] = ((uint32_t)font_color << 16) | bg_color;
+    lut[3] = ((uint32_t)font_color << 16) | font_color;
+
+    for (uint32_t n = 0; n < count; n++)
     {
-        data = ascii0816[c * 16 + i];
-        for (j = 0; j < 8; j++)
+        pdata = &ascii0816[(uint8_t)str[n] * 16];
+        pixel = ptr + 4 * n;
+        for (uint8_t i = 0; i < 16; i++)
         {
-            if (data & 0x80)
-                lcd_draw_point(x + j, y, color);
-            data <<= 1;
+            data = *pdata++;
+            pixel[0] = lut[data >> 6];
+            pixel[1] = lut[(data >> 4) & 3];
+            pixel[2] = lut[(data >> 2) & 3];
+            pixel[3] = lut[data & 3];
+            pixel += width;
         }
-        y++;
     }
 }
 
+void lcd_draw_char(uint16_t x, uint16_t y, char c, uint16_t color)
+{
+    char str[2] = {c, 0};
+
+    lcd_draw_string(x, y, str, color);
+}
+
 void lcd_draw_string(uint16_t x, uint16_t y, char *str, uint16_t color)
 {
-    while (*str)
-    {
-        lcd_draw_char(x, y, *str, color);
-        str++;
-        x += 8;
-    }
+    lcd_draw_string_bg(x, y, str, color, BLACK);
 }
 
-void lcd_ram_draw_string(char *str, uint32_t *ptr, uint16_t font_color, uint16_t bg_color)
+void lcd_draw_string_bg(uint16_t x, uint16_t y, char *str, uint16_t font_color, uint16_t bg_color)
 {
-    uint8_t i = 0;
-    uint8_t j = 0;
-    uint8_t data = 0;
-    uint8_t *pdata = NULL;
-    uint16_t width = 0;
-    uint32_t *pixel = NULL;
+    static uint32_t text_buf[LCD_TEXT_MAX_CHARS * 8 * 16 / 2];
+    uint32_t count = 0;
 
-    width = 4 * strlen(str);
-    while (*str)
+    if (y + 15 > lcd_ctl.height)
+        return;
+    while (*str && x + 7 <= lcd_ctl.width)
     {
-        pdata = (uint8_t *)&ascii0816[(*str) * 16];
-        for (i = 0; i < 16; i++)
-        {
-            data = *pdata++;
-            pixel = ptr + i * width;
-            for (j = 0; j < 4; j++)
-            {
-                switch (data >> 6)
-                {
-                    case 0:
-                        *pixel = ((uint32_t)bg_color << 16) | bg_color;
-                        break;
-                    case 1:
-                        *pixel = ((uint32_t)bg_color << 16) | font_color;
-                        break;
-                    case 2:
-                        *pixel = ((uint32_t)font_color << 16) | bg_color;
-                        break;
-                    case 3:
-                        *pixel = ((uint32_t)font_color << 16) | font_color;
-                        break;
-                    default:
-                        *pixel = 0;
-                        break;
-                }
-                data <<= 2;
-                pixel++;
-            }
-        }
-        str++;
-        ptr += 4;
+        /* As many glyphs as fit both the scratch strip and the visible line */
+        count = 0;
+        while (str[count] && count < LCD_TEXT_MAX_CHARS && x + 8 * count + 7 <= lcd_ctl.width)
+            count++;
+
+        lcd_ram_draw_text(str, count, text_buf, font_color, bg_color);
+        lcd_set_area(x, y, x + 8 * count - 1, y + 15);
+        tft_write_word(text_buf, count * 8 * 16 / 2, 0);
+
+        str += count;
+        x += 8 * count;
     }
 }
 
+void lcd_ram_draw_string(char *str, uint32_t *ptr, uint16_t font_color, uint16_t bg_color)
+{
+    lcd_ram_draw_text(str, strlen(str), ptr, font_color, bg_color);
+}
+
 void lcd_clear(uint16_t color)
+{
+    lcd_fill_rect(0, 0, lcd_ctl.width, lcd_ctl.height, color);
+}
+
+void lcd_fill_rect(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color)
 {
     uint32_t data = ((uint32_t)color << 16) | (uint32_t)color;
 
-    lcd_set_area(0, 0, lcd_ctl.width, lcd_ctl.height);
-    tft_fill_data(&data, LCD_X_MAX * LCD_Y_MAX / 2);
+    if (x1 > lcd_ctl.width || y1 > lcd_ctl.height || x2 < x1 || y2 < y1)
+        return;
+    if (x2 > lcd_ctl.width)
+        x2 = lcd_ctl.width;
+    if (y2 > lcd_ctl.height)
+        y2 = lcd_ctl.height;
+
+    /* The fill DMA repeats one word, so nothing but the colour is read from memory */
+    lcd_set_area(x1, y1, x2, y2);
+    tft_fill_data(&data, ((uint32_t)(x2 - x1 + 1) * (y2 - y1 + 1) + 1) / 2);
 }
 
-void lcd_draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t width, uint16_t color)
+void lcd_draw_hbar(uint16_t x, uint16_t y, uint16_t length, uint16_t thickness, uint16_t color)
 {
-    uint32_t data_buf[640] = {0};
-    uint32_t *p = data_buf;
-    uint32_t data = color;
-    uint32_t index = 0;
+    if (length && thickness)
+        lcd_fill_rect(x, y, x + length - 1, y + thickness - 1, color);
+}
 
-    data = (data << 16) | data;
-    for (index = 0; index < 160 * width; index++)
-        *p++ = data;
+void lcd_draw_vbar(uint16_t x, uint16_t y, uint16_t length, uint16_t thickness, uint16_t color)
+{
+    if (length && thickness)
+        lcd_fill_rect(x, y, x + thickness - 1, y + length - 1, color);
+}
 
-    lcd_set_area(x1, y1, x2, y1 + width - 1);
-    tft_write_word(data_buf, ((x2 - x1 + 1) * width + 1) / 2, 0);
-    lcd_set_area(x1, y2 - width + 1, x2, y2);
-    tft_write_word(data_buf, ((x2 - x1 + 1) * width + 1) / 2, 0);
-    lcd_set_area(x1, y1, x1 + width - 1, y2);
-    tft_write_word(data_buf, ((y2 - y1 + 1) * width + 1) / 2, 0);
-    lcd_set_area(x2 - width + 1, y1, x2, y2);
-    tft_write_word(data_buf, ((y2 - y1 + 1) * width + 1) / 2, 0);
+void lcd_draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t width, uint16_t color)
+{
+    if (!width)
+        return;
+    lcd_fill_rect(x1, y1, x2, y1 + width - 1, color);
+    lcd_fill_rect(x1, y2 - width + 1, x2, y2, color);
+    lcd_fill_rect(x1, y1, x1 + width - 1, y2, color);
+    lcd_fill_rect(x2 - width + 1, y1, x2, y2, color);
+}
+
+void lcd_draw_progress(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t value, uint32_t max,
+                       uint16_t color, uint16_t bg_color)
+{
+    uint16_t inner = x2 - x1 - 1;
+    uint16_t filled = 0;
+
+    if (x2 < x1 + 2 || y2 < y1 + 2)
+        return;
+    if (max)
+        filled = (uint64_t)inner * (value < max ? value : max) / max;
+
+    /* One-pixel frame, then the filled and empty parts of the track */
+    lcd_draw_rectangle(x1, y1, x2, y2, 1, color);
+    if (filled)
+        lcd_fill_rect(x1 + 1, y1 + 1, x1 + filled, y2 - 1, color);
+    if (filled < inner)
+        lcd_fill_rect(x1 + 1 + filled, y1 + 1, x2 - 1, y2 - 1, bg_color);
 }
 
 void lcd_draw_picture(uint16_t x1, uint16_t y1, uint16_t width, uint16_t height, uint32_t *ptr)
@@ -208,3 +234,19 @@ void lcd_draw_picture(uint16_t x1, uint16_t y1, uint16_t width, uint16_t height,
     tft_write_word(ptr, width * height / 2, lcd_ctl.mode ? 2 : 0);
 }
 
+void lcd_draw_picture_async(uint16_t x1, uint16_t y1, uint16_t width, uint16_t height, uint32_t *ptr,
+                            plic_irq_callback_t callback, void *ctx)
+{
+    lcd_set_area(x1, y1, x1 + width - 1, y1 + height - 1);
+    tft_write_word_async(ptr, width * height / 2, callback, ctx);
+}
+
+int lcd_is_busy(void)
+{
+    return tft_is_busy();
+}
+
+void lcd_wait_idle(void)
+{
+    tft_wait_idle();
+}
@@ -2,11 +2,15 @@
 #define _LCD_H_
 
 #include <stdint.h>
+#include "plic.h"
 
 /* clang-format off */
 #define LCD_X_MAX   (240)
 #define LCD_Y_MAX   (320)
 
+/* Glyphs rasterized per text transfer; longer strings go out in several */
+#define LCD_TEXT_MAX_CHARS  (LCD_Y_MAX / 8)
+
 #define BLACK       0x0000
 #define NAVY        0x000F
 #define DARKGREEN   0x03E0
@@ -56,11 +60,25 @@ void lcd_interrupt_enable(void);
 void lcd_init(void);
 void lcd_clear(uint16_t color);
 void lcd_set_direction(lcd_dir_t dir);
+void lcd_get_size(uint16_t *width, uint16_t *height);
 void lcd_set_area(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void lcd_draw_point(uint16_t x, uint16_t y, uint16_t color);
+/* Strings are drawn as opaque 8x16 cells, on black unless a background is given */
 void lcd_draw_string(uint16_t x, uint16_t y, char *str, uint16_t color);
+void lcd_draw_string_bg(uint16_t x, uint16_t y, char *str, uint16_t font_color, uint16_t bg_color);
 void lcd_draw_picture(uint16_t x1, uint16_t y1, uint16_t width, uint16_t height, uint32_t *ptr);
+void lcd_draw_picture_async(uint16_t x1, uint16_t y1, uint16_t width, uint16_t height, uint32_t *ptr,
+                            plic_irq_callback_t callback, void *ctx);
+int lcd_is_busy(void);
+void lcd_wait_idle(void);
+/* Solid shapes are sent with the SPI fill DMA from a single colour word */
+void lcd_fill_rect(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
+void lcd_draw_hbar(uint16_t x, uint16_t y, uint16_t length, uint16_t thickness, uint16_t color);
+void lcd_draw_vbar(uint16_t x, uint16_t y, uint16_t length, uint16_t thickness, uint16_t color);
 void lcd_draw_rectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t width, uint16_t color);
+/* Framed bar filled in proportion to value / max */
+void lcd_draw_progress(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t value, uint32_t max,
+                       uint16_t color, uint16_t bg_color);
 void lcd_ram_draw_string(char *str, uint32_t *ptr, uint16_t font_color, uint16_t bg_color);
 
 #endif
@@ -0,0 +1,119 @@
+#include "lcd_blit.h"
+#include "nt35310.h"
+#include <stddef.h>
+
+static uint32_t blit_ring[LCD_BLIT_RING][LCD_BLIT_BAND_WORDS];
+static uint8_t blit_ring_index;
+
+static inline uint16_t rgb888_to_565(uint8_t r, uint8_t g, uint8_t b) {
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+void lcd_blit_image(uint16_t x, uint16_t y, image_t* image, uint16_t scale, lcd_rotate_t rotate) {
+    lcd_blit_image_roi(x, y, image, 0, 0, image->width, image->height, scale, rotate);
+}
+
+void lcd_blit_image_roi(uint16_t x, uint16_t y, image_t* image, uint16_t src_x, uint16_t src_y, uint16_t src_w,
+                        uint16_t src_h, uint16_t scale, lcd_rotate_t rotate) {
+    uint32_t plane = (uint32_t)image->width * image->height;
+    int32_t stride = image->width;
+    uint8_t rotated = rotate == LCD_ROTATE_90 || rotate == LCD_ROTATE_270;
+    uint32_t rot_w = rotated ? src_h : src_w;
+    uint32_t rot_h = rotated ? src_w : src_h;
+    uint16_t lcd_w, lcd_h, band_lines;
+    uint32_t out_w, out_h, den, step, step_rem;
+    int32_t du, dv, origin;
+
+    if (image->pixel != 2 && image->pixel != 3)
+        return;
+    if (!scale || src_x + src_w > image->width || src_y + src_h > image->height)
+        return;
+
+    lcd_get_size(&lcd_w, &lcd_h);
+    if (x >= lcd_w || y >= lcd_h)
+        return;
+    out_w = rot_w * scale / LCD_BLIT_SCALE_1X;
+    out_h = rot_h * scale / LCD_BLIT_SCALE_1X;
+    if (out_w > (uint32_t)(lcd_w - x))
+        out_w = lcd_w - x;
+    if (out_h > (uint32_t)(lcd_h - y))
+        out_h = lcd_h - y;
+    /* Two pixels per GRAM word, so rows must not end halfway through a word */
+    out_w &= ~1;
+    if (!out_w || !out_h)
+        return;
+
+    /*
+     * Rotated coordinates (u, v) map back to the source as
+     * origin + u * du + v * dv, in pixels from the region's top-left corner.
+     */
+    switch (rotate) {
+    case LCD_ROTATE_90:
+        origin = (src_h - 1) * stride;
+        du = -stride;
+        dv = 1;
+        break;
+    case LCD_ROTATE_180:
+        origin = (src_h - 1) * stride + src_w - 1;
+        du = -1;
+        dv = -stride;
+        break;
+    case LCD_ROTATE_270:
+        origin = src_w - 1;
+        du = stride;
+        dv = -1;
+        break;
+    default:
+        origin = 0;
+        du = 1;
+        dv = stride;
+        break;
+    }
+    origin += src_y * stride + src_x;
+
+    /*
+     * Output pixel o samples the source at its centre, (2o + 1) * 1X / (2 *
+     * scale). Across a row that is stepped as a quotient and remainder, which
+     * stays exact where a rounded fixed-point step drifts onto the wrong
+     * source pixel.
+     */
+    den = 2 * scale;
+    step = 2 * LCD_BLIT_SCALE_1X / den;
+    step_rem = 2 * LCD_BLIT_SCALE_1X % den;
+    band_lines = LCD_BLIT_BAND_WORDS / (out_w / 2);
+
+    lcd_set_area(x, y, x + out_w - 1, y + out_h - 1);
+    for (uint16_t oy = 0; oy < out_h; oy += band_lines) {
+        uint16_t lines = out_h - oy < band_lines ? out_h - oy : band_lines;
+        /* Sends are serialised, so the transfer from this slot has already completed */
+        uint32_t* band = blit_ring[blit_ring_index];
+        uint16_t* pixel = (uint16_t*)band;
+        uint32_t i = 0;
+
+        blit_ring_index = (blit_ring_index + 1) % LCD_BLIT_RING;
+        for (uint16_t line = 0; line < lines; line++) {
+            uint32_t v = (2 * (uint32_t)(oy + line) + 1) * LCD_BLIT_SCALE_1X / den;
+            int32_t row = origin + (int32_t)(v < rot_h ? v : rot_h - 1) * dv;
+            uint32_t u = LCD_BLIT_SCALE_1X / den;
+            uint32_t rem = LCD_BLIT_SCALE_1X % den;
+
+            for (uint16_t ox = 0; ox < out_w; ox++, i++) {
+                uint32_t index = row + (int32_t)(u < rot_w ? u : rot_w - 1) * du;
+
+                if (image->pixel == 2) {
+                    pixel[i ^ 1] = ((uint16_t*)image->addr)[index ^ 1];
+                } else {
+                    const uint8_t* r = image->addr + index;
+                    pixel[i ^ 1] = rgb888_to_565(r[0], r[plane], r[2 * plane]);
+                }
+                u += step;
+                rem += step_rem;
+                if (rem >= den) {
+                    rem -= den;
+                    u++;
+                }
+            }
+        }
+        tft_write_word_async(band, out_w / 2 * lines, NULL, NULL);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef _LCD_BLIT_H_
+#define _LCD_BLIT_H_
+
+#include <stdint.h>
+#include "image_process.h"
+#include "lcd.h"
+
+/* clang-format off */
+/* Scale factors are Q8: 256 shows the source 1:1, 512 doubles it */
+#define LCD_BLIT_SCALE_1X   256
+/* Line buffers in the ring; one is filled while the other is sent */
+#define LCD_BLIT_RING       2
+/* Words per line buffer, four full 320-pixel lines */
+#define LCD_BLIT_BAND_WORDS (LCD_Y_MAX / 2 * 4)
+/* clang-format on */
+
+/* Clockwise rotation applied before scaling */
+typedef enum _lcd_rotate {
+    LCD_ROTATE_0,
+    LCD_ROTATE_90,
+    LCD_ROTATE_180,
+    LCD_ROTATE_270,
+} lcd_rotate_t;
+
+/*
+ * Show an image_t on the panel with its top-left corner at (x, y), resampled
+ * with nearest-neighbour lookups. Images with pixel == 2 are RGB565 in GRAM
+ * order (as the DVP display output writes them), pixel == 3 planar RGB888.
+ * Output rows are generated into small line buffers and streamed to the panel
+ * as they are produced, so no intermediate frame is allocated. The output is
+ * clipped to the panel and its width rounded down to an even pixel count.
+ */
+void lcd_blit_image(uint16_t x, uint16_t y, image_t* image, uint16_t scale, lcd_rotate_t rotate);
+/* Same for the src_w x src_h region of the image at (src_x, src_y) */
+void lcd_blit_image_roi(uint16_t x, uint16_t y, image_t* image, uint16_t src_x, uint16_t src_y, uint16_t src_w,
+                        uint16_t src_h, uint16_t scale, lcd_rotate_t rotate);
+
+#endif
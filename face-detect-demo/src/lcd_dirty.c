@@ -0,0 +1,185 @@
+#include "lcd_dirty.h"
+#include "lcd_overlay.h"
+#include "nt35310.h"
+#include <string.h>
+
+static uint32_t rect_area(const lcd_rect_t* r) {
+    return (uint32_t)(r->x2 - r->x1 + 1) * (r->y2 - r->y1 + 1);
+}
+
+static lcd_rect_t rect_union(const lcd_rect_t* a, const lcd_rect_t* b) {
+    lcd_rect_t u;
+
+    u.x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+    u.y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+    u.x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+    u.y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+    return u;
+}
+
+static uint32_t rect_overlap(const lcd_rect_t* a, const lcd_rect_t* b) {
+    int32_t w = (int32_t)(a->x2 < b->x2 ? a->x2 : b->x2) - (a->x1 > b->x1 ? a->x1 : b->x1) + 1;
+    int32_t h = (int32_t)(a->y2 < b->y2 ? a->y2 : b->y2) - (a->y1 > b->y1 ? a->y1 : b->y1) + 1;
+
+    return (w > 0 && h > 0) ? (uint32_t)(w * h) : 0;
+}
+
+/* Pixels the bounding box of a and b covers that neither of them does */
+static uint32_t rect_merge_waste(const lcd_rect_t* a, const lcd_rect_t* b) {
+    lcd_rect_t u = rect_union(a, b);
+    uint32_t covered = rect_area(a) + rect_area(b) - rect_overlap(a, b);
+
+    return rect_area(&u) - covered;
+}
+
+static void lcd_dirty_remove(lcd_dirty_t* dirty, uint8_t index) {
+    dirty->rect[index] = dirty->rect[--dirty->count];
+}
+
+void lcd_dirty_init(lcd_dirty_t* dirty, uint32_t* gram, uint16_t width, uint16_t height) {
+    dirty->gram = gram;
+    dirty->width = width;
+    dirty->height = height;
+    dirty->count = 0;
+    dirty->frame_bytes = 0;
+    dirty->total_bytes = 0;
+    dirty->overlay = NULL;
+    memset(dirty->block_hash, 0, sizeof(dirty->block_hash));
+    lcd_dirty_add_all(dirty);
+}
+
+void lcd_dirty_set_gram(lcd_dirty_t* dirty, uint32_t* gram) {
+    dirty->gram = gram;
+}
+
+void lcd_dirty_set_overlay(lcd_dirty_t* dirty, struct _lcd_overlay* overlay) {
+    dirty->overlay = overlay;
+}
+
+void lcd_dirty_add(lcd_dirty_t* dirty, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+    lcd_rect_t r;
+    uint8_t i;
+
+    if (x1 >= dirty->width || y1 >= dirty->height || x2 < x1 || y2 < y1)
+        return;
+    if (x2 >= dirty->width)
+        x2 = dirty->width - 1;
+    if (y2 >= dirty->height)
+        y2 = dirty->height - 1;
+
+    /* Two pixels share a GRAM word, so rectangles start and end on word boundaries */
+    r.x1 = x1 & ~1;
+    r.x2 = x2 | 1;
+    r.y1 = y1;
+    r.y2 = y2;
+
+    /* Absorb every rectangle that merges cheaply, then retry with the grown one */
+    for (i = 0; i < dirty->count;) {
+        if (rect_merge_waste(&r, &dirty->rect[i]) <= LCD_DIRTY_MERGE_SLACK) {
+            r = rect_union(&r, &dirty->rect[i]);
+            lcd_dirty_remove(dirty, i);
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (dirty->count == LCD_DIRTY_MAX_RECTS) {
+        uint8_t best = 0;
+        uint32_t best_waste = UINT32_MAX;
+
+        for (i = 0; i < dirty->count; i++) {
+            uint32_t waste = rect_merge_waste(&r, &dirty->rect[i]);
+            if (waste < best_waste) {
+                best_waste = waste;
+                best = i;
+            }
+        }
+        r = rect_union(&r, &dirty->rect[best]);
+        lcd_dirty_remove(dirty, best);
+    }
+    dirty->rect[dirty->count++] = r;
+}
+
+void lcd_dirty_add_all(lcd_dirty_t* dirty) {
+    dirty->count = 0;
+    lcd_dirty_add(dirty, 0, 0, dirty->width - 1, dirty->height - 1);
+}
+
+uint32_t lcd_dirty_diff(lcd_dirty_t* dirty) {
+    uint16_t words_per_line = dirty->width / 2;
+    uint32_t* hash = dirty->block_hash;
+    uint32_t changed = 0;
+
+    if (dirty->overlay)
+        lcd_overlay_mark_dirty(dirty->overlay, dirty);
+    for (uint16_t by = 0; by < dirty->height; by += LCD_DIRTY_BLOCK_H) {
+        uint16_t bh = dirty->height - by < LCD_DIRTY_BLOCK_H ? dirty->height - by : LCD_DIRTY_BLOCK_H;
+
+        for (uint16_t bx = 0; bx < dirty->width; bx += LCD_DIRTY_BLOCK_W) {
+            uint16_t bw = dirty->width - bx < LCD_DIRTY_BLOCK_W ? dirty->width - bx : LCD_DIRTY_BLOCK_W;
+            const uint32_t* line = dirty->gram + by * words_per_line + bx / 2;
+            uint32_t h = 2166136261U;
+
+            /* FNV-1a over whole GRAM words */
+            for (uint16_t y = 0; y < bh; y++, line += words_per_line) {
+                for (uint16_t x = 0; x < bw / 2; x++)
+                    h = (h ^ line[x]) * 16777619U;
+            }
+            if (*hash != h) {
+                *hash = h;
+                lcd_dirty_add(dirty, bx, by, bx + bw - 1, by + bh - 1);
+                changed++;
+            }
+            hash++;
+        }
+    }
+    return changed;
+}
+
+uint32_t lcd_dirty_flush(lcd_dirty_t* dirty) {
+    uint16_t words_per_line = dirty->width / 2;
+    uint32_t frame_area = (uint32_t)dirty->width * dirty->height;
+    uint32_t area = 0;
+    uint32_t bytes = 0;
+    uint8_t i;
+
+    for (i = 0; i < dirty->count; i++)
+        area += rect_area(&dirty->rect[i]);
+
+    if (area * 100 >= frame_area * LCD_DIRTY_FULL_PERCENT) {
+        lcd_rect_t full = {0, 0, dirty->width - 1, dirty->height - 1};
+
+        /* Returns while the frame streams out; the next LCD call waits for it */
+        if (dirty->overlay)
+            lcd_overlay_stream(dirty->overlay, dirty->gram, dirty->width, &full);
+        else
+            lcd_draw_picture_async(0, 0, dirty->width, dirty->height, dirty->gram, NULL, NULL);
+        bytes = frame_area * 2;
+    } else {
+        for (i = 0; i < dirty->count; i++) {
+            lcd_rect_t* r = &dirty->rect[i];
+            uint16_t words = (r->x2 - r->x1 + 1) / 2;
+            uint32_t* line = dirty->gram + r->y1 * words_per_line + r->x1 / 2;
+
+            if (dirty->overlay) {
+                lcd_overlay_stream(dirty->overlay, dirty->gram, dirty->width, r);
+            } else {
+                lcd_set_area(r->x1, r->y1, r->x2, r->y2);
+                if (words == words_per_line) {
+                    /* Full-width rows are contiguous in the framebuffer */
+                    tft_write_word(line, words * (r->y2 - r->y1 + 1), 0);
+                } else {
+                    for (uint16_t y = r->y1; y <= r->y2; y++, line += words_per_line)
+                        tft_write_word(line, words, 0);
+                }
+            }
+            bytes += rect_area(r) * 2;
+        }
+    }
+
+    dirty->count = 0;
+    dirty->frame_bytes = bytes;
+    dirty->total_bytes += bytes;
+    return bytes;
+}
@@ -0,0 +1,60 @@
+#ifndef _LCD_DIRTY_H_
+#define _LCD_DIRTY_H_
+
+#include <stdint.h>
+#include "lcd.h"
+
+/* clang-format off */
+#define LCD_DIRTY_MAX_RECTS     16
+#define LCD_DIRTY_BLOCK_W       32
+#define LCD_DIRTY_BLOCK_H       16
+#define LCD_DIRTY_MAX_BLOCKS    (((LCD_Y_MAX + LCD_DIRTY_BLOCK_W - 1) / LCD_DIRTY_BLOCK_W) * \
+                                 ((LCD_Y_MAX + LCD_DIRTY_BLOCK_H - 1) / LCD_DIRTY_BLOCK_H))
+/* Extra pixels two rectangles may waste when merged into their bounding box */
+#define LCD_DIRTY_MERGE_SLACK   1024
+/* Above this share of the frame one full transfer beats many partial ones */
+#define LCD_DIRTY_FULL_PERCENT  70
+/* clang-format on */
+
+typedef struct _lcd_rect {
+    uint16_t x1;
+    uint16_t y1;
+    uint16_t x2;
+    uint16_t y2;
+} lcd_rect_t;
+
+struct _lcd_overlay;
+
+/*
+ * Damage tracking for a RAM framebuffer in LCD GRAM layout. Drawing code
+ * reports what it touched with lcd_dirty_add, camera frames can be compared
+ * block by block with lcd_dirty_diff, and lcd_dirty_flush sends only the
+ * merged dirty rectangles to the panel. A full-frame flush is started
+ * asynchronously, so the framebuffer must not be rewritten until
+ * lcd_wait_idle() returns or another LCD call has been made.
+ *
+ * With an overlay attached, diffs also cover what its items draw now and drew
+ * last frame, and flushes composite the items while streaming.
+ */
+typedef struct _lcd_dirty {
+    uint32_t* gram;
+    uint16_t width;
+    uint16_t height;
+    uint8_t count;
+    lcd_rect_t rect[LCD_DIRTY_MAX_RECTS];
+    uint32_t block_hash[LCD_DIRTY_MAX_BLOCKS];
+    uint32_t frame_bytes;
+    uint64_t total_bytes;
+    struct _lcd_overlay* overlay;
+} lcd_dirty_t;
+
+void lcd_dirty_init(lcd_dirty_t* dirty, uint32_t* gram, uint16_t width, uint16_t height);
+/* Switch to another framebuffer; hashes still describe what the panel shows */
+void lcd_dirty_set_gram(lcd_dirty_t* dirty, uint32_t* gram);
+void lcd_dirty_set_overlay(lcd_dirty_t* dirty, struct _lcd_overlay* overlay);
+void lcd_dirty_add(lcd_dirty_t* dirty, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+void lcd_dirty_add_all(lcd_dirty_t* dirty);
+uint32_t lcd_dirty_diff(lcd_dirty_t* dirty);
+uint32_t lcd_dirty_flush(lcd_dirty_t* dirty);
+
+#endif
@@ -0,0 +1,250 @@
+#include "lcd_fb.h"
+#include <string.h>
+
+#define FB_PIXEL(gram, i) (((uint16_t*)(gram))[(i) ^ 1])
+
+/* Clip [*a, *b] (either order) to [0, limit); returns 0 when nothing is left */
+static int clip_span(int32_t* a, int32_t* b, int32_t limit) {
+    if (*a > *b) {
+        int32_t t = *a;
+        *a = *b;
+        *b = t;
+    }
+    if (*b < 0 || *a >= limit)
+        return 0;
+    if (*a < 0)
+        *a = 0;
+    if (*b >= limit)
+        *b = limit - 1;
+    return 1;
+}
+
+/* Already clipped run of pixels x1..x2 on one row */
+static void fill_span(uint32_t* row, int32_t x1, int32_t x2, uint32_t data) {
+    uint32_t* dst;
+    uint32_t words;
+
+    if (x1 & 1) {
+        FB_PIXEL(row, x1) = (uint16_t)data;
+        x1++;
+    }
+    if (!(x2 & 1)) {
+        if (x2 >= x1)
+            FB_PIXEL(row, x2) = (uint16_t)data;
+        x2--;
+    }
+    if (x2 < x1)
+        return;
+
+    dst = row + x1 / 2;
+    words = (x2 - x1 + 1) / 2;
+    if (((uintptr_t)dst & 7) && words) {
+        *dst++ = data;
+        words--;
+    }
+    for (uint64_t data64 = ((uint64_t)data << 32) | data; words >= 2; words -= 2, dst += 2)
+        *(uint64_t*)dst = data64;
+    if (words)
+        *dst = data;
+}
+
+void lcd_fb_init(lcd_fb_t* fb, uint32_t* gram, uint16_t width, uint16_t height) {
+    fb->gram = gram;
+    fb->width = width;
+    fb->height = height;
+}
+
+void lcd_fb_point(lcd_fb_t* fb, int32_t x, int32_t y, uint16_t color) {
+    if (x >= 0 && y >= 0 && x < fb->width && y < fb->height)
+        FB_PIXEL(fb->gram, y * fb->width + x) = color;
+}
+
+void lcd_fb_hline(lcd_fb_t* fb, int32_t x1, int32_t x2, int32_t y, uint16_t color) {
+    lcd_fb_fill_rect(fb, x1, y, x2, y, color);
+}
+
+void lcd_fb_vline(lcd_fb_t* fb, int32_t x, int32_t y1, int32_t y2, uint16_t color) {
+    uint16_t* p;
+
+    if (x < 0 || x >= fb->width || !clip_span(&y1, &y2, fb->height))
+        return;
+    p = &FB_PIXEL(fb->gram, y1 * fb->width + x);
+    for (int32_t y = y1; y <= y2; y++, p += fb->width)
+        *p = color;
+}
+
+void lcd_fb_fill_rect(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color) {
+    uint32_t data = ((uint32_t)color << 16) | color;
+    uint32_t words_per_line = fb->width / 2;
+    uint32_t* row;
+
+    if (!clip_span(&x1, &x2, fb->width) || !clip_span(&y1, &y2, fb->height))
+        return;
+    row = fb->gram + y1 * words_per_line;
+    for (int32_t y = y1; y <= y2; y++, row += words_per_line)
+        fill_span(row, x1, x2, data);
+}
+
+void lcd_fb_rect(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t thickness, uint16_t color) {
+    int32_t t = thickness ? thickness - 1 : 0;
+
+    if (x1 > x2) {
+        int32_t tmp = x1;
+        x1 = x2;
+        x2 = tmp;
+    }
+    if (y1 > y2) {
+        int32_t tmp = y1;
+        y1 = y2;
+        y2 = tmp;
+    }
+    /* Nothing left inside the outline */
+    if (x2 - x1 <= 2 * t + 1 || y2 - y1 <= 2 * t + 1) {
+        lcd_fb_fill_rect(fb, x1, y1, x2, y2, color);
+        return;
+    }
+    /* Top and bottom bands span the full width, the sides fill in between */
+    lcd_fb_fill_rect(fb, x1, y1, x2, y1 + t, color);
+    lcd_fb_fill_rect(fb, x1, y2 - t, x2, y2, color);
+    lcd_fb_fill_rect(fb, x1, y1 + t + 1, x1 + t, y2 - t - 1, color);
+    lcd_fb_fill_rect(fb, x2 - t, y1 + t + 1, x2, y2 - t - 1, color);
+}
+
+void lcd_fb_line(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color) {
+    int32_t dx, dy, sx, sy, err;
+
+    if (y1 == y2) {
+        lcd_fb_hline(fb, x1, x2, y1, color);
+        return;
+    }
+    if (x1 == x2) {
+        lcd_fb_vline(fb, x1, y1, y2, color);
+        return;
+    }
+
+    /* Bresenham, clipping per pixel */
+    dx = x2 > x1 ? x2 - x1 : x1 - x2;
+    dy = y2 > y1 ? y1 - y2 : y2 - y1;
+    sx = x1 < x2 ? 1 : -1;
+    sy = y1 < y2 ? 1 : -1;
+    err = dx + dy;
+    while (1) {
+        int32_t e2 = 2 * err;
+
+        lcd_fb_point(fb, x1, y1, color);
+        if (x1 == x2 && y1 == y2)
+            break;
+        if (e2 >= dy) {
+            err += dy;
+            x1 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y1 += sy;
+        }
+    }
+}
+
+void lcd_fb_corners(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t length,
+                    uint16_t thickness, uint16_t color) {
+    int32_t lx, ly, t;
+
+    if (!length || !thickness)
+        return;
+    if (x1 > x2) {
+        int32_t tmp = x1;
+        x1 = x2;
+        x2 = tmp;
+    }
+    if (y1 > y2) {
+        int32_t tmp = y1;
+        y1 = y2;
+        y2 = tmp;
+    }
+    /* Arms never reach past the box, so small boxes stay inside their bounds */
+    lx = (length < x2 - x1 + 1 ? length : x2 - x1 + 1) - 1;
+    ly = (length < y2 - y1 + 1 ? length : y2 - y1 + 1) - 1;
+    t = (thickness < lx + 1 ? thickness : lx + 1) - 1;
+    t = t < ly ? t : ly;
+    lcd_fb_fill_rect(fb, x1, y1, x1 + lx, y1 + t, color);
+    lcd_fb_fill_rect(fb, x1, y1, x1 + t, y1 + ly, color);
+    lcd_fb_fill_rect(fb, x2 - lx, y1, x2, y1 + t, color);
+    lcd_fb_fill_rect(fb, x2 - t, y1, x2, y1 + ly, color);
+    lcd_fb_fill_rect(fb, x1, y2 - t, x1 + lx, y2, color);
+    lcd_fb_fill_rect(fb, x1, y2 - ly, x1 + t, y2, color);
+    lcd_fb_fill_rect(fb, x2 - lx, y2 - t, x2, y2, color);
+    lcd_fb_fill_rect(fb, x2 - t, y2 - ly, x2, y2, color);
+}
+
+/* Mix two RGB565 pixels with a 0..32 weight on a, all channels at once */
+static inline uint16_t blend565(uint16_t a, uint16_t b, uint32_t weight) {
+    uint32_t wa = (a | ((uint32_t)a << 16)) & 0x07E0F81F;
+    uint32_t wb = (b | ((uint32_t)b << 16)) & 0x07E0F81F;
+    uint32_t mix = ((wa * weight + wb * (32 - weight)) >> 5) & 0x07E0F81F;
+
+    return (uint16_t)(mix | (mix >> 16));
+}
+
+typedef enum {
+    BLIT_COPY,
+    BLIT_KEY,
+    BLIT_ALPHA,
+} blit_mode_t;
+
+static void lcd_fb_blit_mode(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width,
+                             uint16_t height, blit_mode_t mode, uint16_t key, uint8_t alpha) {
+    int32_t x1 = x, x2 = x + width - 1;
+    int32_t y1 = y, y2 = y + height - 1;
+    uint32_t weight = (alpha + 4) >> 3;
+
+    if (!width || !height || !clip_span(&x1, &x2, fb->width) || !clip_span(&y1, &y2, fb->height))
+        return;
+
+    for (int32_t row = y1; row <= y2; row++) {
+        const uint32_t* src_row = src + (row - y) * (width / 2);
+        uint32_t* dst_row = fb->gram + row * (fb->width / 2);
+        int32_t sx = x1 - x;
+
+        /* Same word phase on both sides: whole words can be copied as they are */
+        if (mode == BLIT_COPY && !((x1 ^ sx) & 1)) {
+            int32_t dx1 = x1, dx2 = x2;
+
+            if (dx1 & 1) {
+                FB_PIXEL(dst_row, dx1) = FB_PIXEL(src_row, sx);
+                dx1++;
+                sx++;
+            }
+            if (!(dx2 & 1) && dx2 >= dx1) {
+                FB_PIXEL(dst_row, dx2) = FB_PIXEL(src_row, sx + dx2 - dx1);
+                dx2--;
+            }
+            if (dx2 > dx1)
+                memcpy(dst_row + dx1 / 2, src_row + sx / 2, (dx2 - dx1 + 1) * 2);
+            continue;
+        }
+
+        for (int32_t dx = x1; dx <= x2; dx++, sx++) {
+            uint16_t pixel = FB_PIXEL(src_row, sx);
+
+            if (mode == BLIT_KEY && pixel == key)
+                continue;
+            if (mode == BLIT_ALPHA)
+                pixel = blend565(pixel, FB_PIXEL(dst_row, dx), weight);
+            FB_PIXEL(dst_row, dx) = pixel;
+        }
+    }
+}
+
+void lcd_fb_blit(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height) {
+    lcd_fb_blit_mode(fb, x, y, src, width, height, BLIT_COPY, 0, 0);
+}
+
+void lcd_fb_blit_key(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height,
+                     uint16_t key) {
+    lcd_fb_blit_mode(fb, x, y, src, width, height, BLIT_KEY, key, 0);
+}
+
+void lcd_fb_blit_alpha(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height,
+                       uint8_t alpha) {
+    lcd_fb_blit_mode(fb, x, y, src, width, height, BLIT_ALPHA, 0, alpha);
+}
@@ -0,0 +1,42 @@
+#ifndef _LCD_FB_H_
+#define _LCD_FB_H_
+
+#include <stdint.h>
+
+/*
+ * 2D drawing on RAM framebuffers in LCD GRAM layout: RGB565, two pixels per
+ * 32-bit word with the left pixel in the upper halfword. Coordinates are
+ * signed and everything is clipped to the framebuffer, so shapes may hang
+ * off any edge. Horizontal runs are written as whole words (64-bit stores
+ * where aligned) with at most one halfword store at each end. The width must
+ * be even.
+ */
+typedef struct _lcd_fb {
+    uint32_t* gram;
+    uint16_t width;
+    uint16_t height;
+} lcd_fb_t;
+
+void lcd_fb_init(lcd_fb_t* fb, uint32_t* gram, uint16_t width, uint16_t height);
+void lcd_fb_point(lcd_fb_t* fb, int32_t x, int32_t y, uint16_t color);
+void lcd_fb_hline(lcd_fb_t* fb, int32_t x1, int32_t x2, int32_t y, uint16_t color);
+void lcd_fb_vline(lcd_fb_t* fb, int32_t x, int32_t y1, int32_t y2, uint16_t color);
+/* Inclusive corners; the outline grows inwards by thickness pixels */
+void lcd_fb_rect(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t thickness, uint16_t color);
+void lcd_fb_fill_rect(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color);
+void lcd_fb_line(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t color);
+/* Corner brackets of the given arm length, e.g. around a detection box */
+void lcd_fb_corners(lcd_fb_t* fb, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint16_t length,
+                    uint16_t thickness, uint16_t color);
+/*
+ * Copy a GRAM-layout image of width x height pixels (width even) to (x, y).
+ * The keyed variant skips source pixels equal to key; the alpha variant mixes
+ * alpha / 255 of the source over the framebuffer.
+ */
+void lcd_fb_blit(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height);
+void lcd_fb_blit_key(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height,
+                     uint16_t key);
+void lcd_fb_blit_alpha(lcd_fb_t* fb, int32_t x, int32_t y, const uint32_t* src, uint16_t width, uint16_t height,
+                       uint8_t alpha);
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include "lcd_font.h"
+#include "font.h"
+
+/* Two horizontally adjacent pixel bits -> the GRAM word lanes they cover */
+static const uint32_t pair_mask[4] = {0x00000000, 0x0000FFFF, 0xFFFF0000, 0xFFFFFFFF};
+
+int lcd_font_init(lcd_font_t *font, uint8_t scale)
+{
+    if (scale == 0 || scale > LCD_FONT_MAX_SCALE)
+        return -1;
+
+    font->rows = malloc(LCD_FONT_GLYPHS * LCD_FONT_HEIGHT * sizeof(uint32_t));
+    if (font->rows == NULL)
+        return -1;
+    font->scale = scale;
+    font->width = LCD_FONT_WIDTH * scale;
+    font->height = LCD_FONT_HEIGHT * scale;
+
+    for (uint32_t i = 0; i < LCD_FONT_GLYPHS * LCD_FONT_HEIGHT; i++)
+    {
+        uint8_t data = ascii0816[i];
+        uint32_t bits = 0;
+
+        /* Each font bit becomes scale pixel bits, leftmost pixel at bit 31 */
+        for (uint8_t j = 0; j < LCD_FONT_WIDTH; j++, data <<= 1)
+            bits = (bits << scale) | ((data & 0x80) ? (1U << scale) - 1 : 0);
+        font->rows[i] = bits << (32 - font->width);
+    }
+    return 0;
+}
+
+void lcd_font_deinit(lcd_font_t *font)
+{
+    free(font->rows);
+    font->rows = NULL;
+}
+
+static void lcd_font_draw(const lcd_font_t *font, uint32_t *gram, uint16_t gram_width, uint16_t gram_height,
+                          int32_t x, int32_t y, const char *str, uint16_t font_color, uint16_t bg_color, int opaque)
+{
+    uint32_t fg = ((uint32_t)font_color << 16) | font_color;
+    uint32_t bg = ((uint32_t)bg_color << 16) | bg_color;
+    int32_t words_per_line = gram_width / 2;
+    int32_t y0 = y < 0 ? 0 : y;
+    int32_t y1 = y + font->height > gram_height ? gram_height : y + font->height;
+    /* Cell bits for the string's pixel phase: pixel x sits in bit 63 - (x & 1) */
+    uint64_t cell = ((uint64_t)(0xFFFFFFFFU << (32 - font->width)) << 32) >> (x & 1);
+    uint8_t words = ((x & 1) + font->width + 1) / 2;
+
+    if (font->rows == NULL || y0 >= y1)
+        return;
+
+    for (; *str && x < gram_width; str++, x += font->width)
+    {
+        const uint32_t *glyph = font->rows + (uint8_t)*str * LCD_FONT_HEIGHT;
+        int32_t wx = x >> 1;
+        /* Words of this glyph inside the row; 32-bit so far-off-screen x cannot wrap */
+        int32_t k0 = wx < 0 ? -wx : 0;
+        int32_t k1 = wx + words > words_per_line ? words_per_line - wx : words;
+
+        if (k0 >= k1)
+            continue;
+        for (int32_t row = y0; row < y1; row++)
+        {
+            uint64_t line = ((uint64_t)glyph[(row - y) / font->scale] << 32) >> (x & 1);
+            uint32_t *dst = gram + row * words_per_line + wx;
+
+            for (int32_t k = k0; k < k1; k++)
+            {
+                uint8_t shift = 62 - 2 * k;
+                uint32_t mask = pair_mask[(line >> shift) & 3];
+                uint32_t cover = opaque ? pair_mask[(cell >> shift) & 3] : mask;
+
+                dst[k] = (dst[k] & ~cover) | (fg & mask) | (bg & cover & ~mask);
+            }
+        }
+    }
+}
+
+void lcd_font_draw_string(const lcd_font_t *font, uint32_t *gram, uint16_t gram_width, uint16_t gram_height,
+                          int32_t x, int32_t y, const char *str, uint16_t font_color)
+{
+    lcd_font_draw(font, gram, gram_width, gram_height, x, y, str, font_color, 0, 0);
+}
+
+void lcd_font_draw_string_bg(const lcd_font_t *font, uint32_t *gram, uint16_t gram_width, uint16_t gram_height,
+                             int32_t x, int32_t y, const char *str, uint16_t font_color, uint16_t bg_color)
+{
+    lcd_font_draw(font, gram, gram_width, gram_height, x, y, str, font_color, bg_color, 1);
+}
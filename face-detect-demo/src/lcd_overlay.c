@@ -0,0 +1,156 @@
+#include "lcd_overlay.h"
+#include "lcd_fb.h"
+#include "nt35310.h"
+#include <string.h>
+
+static uint32_t overlay_ring[LCD_OVERLAY_RING][LCD_OVERLAY_BAND_WORDS];
+static uint8_t overlay_ring_index;
+
+static int item_hits(const lcd_overlay_item_t* item, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    return item->x1 <= x2 && item->x2 >= x1 && item->y1 <= y2 && item->y2 >= y1;
+}
+
+/* Bounds clipped at the top-left, or 0 when the item lies entirely off it there */
+static int item_bounds(const lcd_overlay_item_t* item, lcd_rect_t* r) {
+    if (item->x2 < 0 || item->y2 < 0)
+        return 0;
+    r->x1 = item->x1 < 0 ? 0 : item->x1;
+    r->y1 = item->y1 < 0 ? 0 : item->y1;
+    r->x2 = item->x2;
+    r->y2 = item->y2;
+    return 1;
+}
+
+static lcd_overlay_item_t* lcd_overlay_new_item(lcd_overlay_t* overlay) {
+    if (overlay->count == LCD_OVERLAY_MAX_ITEMS)
+        return NULL;
+    return &overlay->item[overlay->count++];
+}
+
+int lcd_overlay_init(lcd_overlay_t* overlay) {
+    overlay->count = 0;
+    overlay->prev_count = 0;
+    return lcd_font_init(&overlay->font, 1);
+}
+
+void lcd_overlay_clear(lcd_overlay_t* overlay) {
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < overlay->count; i++) {
+        if (item_bounds(&overlay->item[i], &overlay->prev_bounds[n]))
+            n++;
+    }
+    overlay->prev_count = n;
+    overlay->count = 0;
+}
+
+int lcd_overlay_add_box(lcd_overlay_t* overlay, int16_t x1, int16_t y1, int16_t x2, int16_t y2, lcd_overlay_type_t type,
+                        uint8_t thickness, uint16_t color) {
+    lcd_overlay_item_t* item = lcd_overlay_new_item(overlay);
+
+    if (item == NULL)
+        return -1;
+    item->type = type;
+    item->thickness = thickness;
+    item->color = color;
+    item->x1 = x1 < x2 ? x1 : x2;
+    item->x2 = x1 < x2 ? x2 : x1;
+    item->y1 = y1 < y2 ? y1 : y2;
+    item->y2 = y1 < y2 ? y2 : y1;
+    return 0;
+}
+
+int lcd_overlay_add_text(lcd_overlay_t* overlay, int16_t x, int16_t y, const char* text, uint16_t color) {
+    lcd_overlay_item_t* item = lcd_overlay_new_item(overlay);
+    size_t len = strlen(text);
+
+    if (item == NULL)
+        return -1;
+    if (len >= LCD_OVERLAY_TEXT_LEN)
+        len = LCD_OVERLAY_TEXT_LEN - 1;
+    memcpy(item->text, text, len);
+    item->text[len] = '\0';
+    item->type = LCD_OVERLAY_TEXT;
+    item->color = color;
+    item->x1 = x;
+    item->y1 = y;
+    item->x2 = x + len * overlay->font.width - 1;
+    item->y2 = y + overlay->font.height - 1;
+    return 0;
+}
+
+void lcd_overlay_mark_dirty(lcd_overlay_t* overlay, lcd_dirty_t* dirty) {
+    lcd_rect_t r;
+
+    for (uint8_t i = 0; i < overlay->prev_count; i++) {
+        r = overlay->prev_bounds[i];
+        lcd_dirty_add(dirty, r.x1, r.y1, r.x2, r.y2);
+    }
+    for (uint8_t i = 0; i < overlay->count; i++) {
+        if (item_bounds(&overlay->item[i], &r))
+            lcd_dirty_add(dirty, r.x1, r.y1, r.x2, r.y2);
+    }
+}
+
+/* Draw every item over a band whose top-left pixel is (x, y) on the panel */
+static void lcd_overlay_compose(lcd_overlay_t* overlay, uint32_t* band, uint16_t width, uint16_t lines, int32_t x,
+                                int32_t y) {
+    lcd_fb_t fb;
+
+    lcd_fb_init(&fb, band, width, lines);
+    for (uint8_t i = 0; i < overlay->count; i++) {
+        lcd_overlay_item_t* item = &overlay->item[i];
+
+        if (!item_hits(item, x, y, x + width - 1, y + lines - 1))
+            continue;
+        switch (item->type) {
+        case LCD_OVERLAY_RECT:
+            lcd_fb_rect(&fb, item->x1 - x, item->y1 - y, item->x2 - x, item->y2 - y, item->thickness, item->color);
+            break;
+        case LCD_OVERLAY_CORNERS:
+            lcd_fb_corners(&fb, item->x1 - x, item->y1 - y, item->x2 - x, item->y2 - y, 8, item->thickness,
+                           item->color);
+            break;
+        case LCD_OVERLAY_TEXT:
+            lcd_font_draw_string(&overlay->font, band, width, lines, item->x1 - x, item->y1 - y, item->text,
+                                 item->color);
+            break;
+        }
+    }
+}
+
+void lcd_overlay_stream(lcd_overlay_t* overlay, const uint32_t* gram, uint16_t gram_width, const lcd_rect_t* rect) {
+    uint16_t words_per_line = gram_width / 2;
+    uint16_t words = (rect->x2 - rect->x1 + 1) / 2;
+    uint16_t band_lines = LCD_OVERLAY_BAND_WORDS / words;
+
+    lcd_set_area(rect->x1, rect->y1, rect->x2, rect->y2);
+    for (uint16_t y = rect->y1; y <= rect->y2; y += band_lines) {
+        uint16_t lines = rect->y2 - y + 1 < band_lines ? rect->y2 - y + 1 : band_lines;
+        uint32_t* src = (uint32_t*)gram + y * words_per_line + rect->x1 / 2;
+        uint32_t* band;
+        uint8_t hit = 0;
+
+        for (uint8_t i = 0; i < overlay->count && !hit; i++)
+            hit = item_hits(&overlay->item[i], rect->x1, y, rect->x2, y + lines - 1);
+
+        if (!hit) {
+            /* Nothing drawn here, the frame itself can be sent */
+            if (words == words_per_line) {
+                tft_write_word_async(src, words * lines, NULL, NULL);
+            } else {
+                for (uint16_t i = 0; i < lines; i++, src += words_per_line)
+                    tft_write_word(src, words, 0);
+            }
+            continue;
+        }
+
+        /* Sends are serialised, so the transfer from this slot has already completed */
+        band = overlay_ring[overlay_ring_index];
+        overlay_ring_index = (overlay_ring_index + 1) % LCD_OVERLAY_RING;
+        for (uint16_t i = 0; i < lines; i++, src += words_per_line)
+            memcpy(band + i * words, src, words * sizeof(uint32_t));
+        lcd_overlay_compose(overlay, band, words * 2, lines, rect->x1, y);
+        tft_write_word_async(band, words * lines, NULL, NULL);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef _LCD_OVERLAY_H_
+#define _LCD_OVERLAY_H_
+
+#include <stdint.h>
+#include "lcd_dirty.h"
+#include "lcd_font.h"
+
+/* clang-format off */
+#define LCD_OVERLAY_MAX_ITEMS   16
+#define LCD_OVERLAY_TEXT_LEN    24
+/* Scanline buffers in flight; one is filled while the previous one is sent */
+#define LCD_OVERLAY_RING        2
+/* Words per scanline buffer, eight full 320-pixel lines */
+#define LCD_OVERLAY_BAND_WORDS  (LCD_Y_MAX / 2 * 8)
+/* clang-format on */
+
+typedef enum _lcd_overlay_type {
+    LCD_OVERLAY_RECT,
+    LCD_OVERLAY_CORNERS,
+    LCD_OVERLAY_TEXT,
+} lcd_overlay_type_t;
+
+typedef struct _lcd_overlay_item {
+    uint8_t type;
+    uint8_t thickness;
+    uint16_t color;
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    char text[LCD_OVERLAY_TEXT_LEN];
+} lcd_overlay_item_t;
+
+/*
+ * Boxes and labels drawn over a camera frame without touching it. Items are
+ * composited into a small ring of scanline buffers while the frame is streamed
+ * to the panel; bands no item touches are sent straight from the frame. The
+ * bounds of the previous frame's items are kept so lcd_dirty can redraw what
+ * they used to cover.
+ */
+typedef struct _lcd_overlay {
+    uint8_t count;
+    uint8_t prev_count;
+    lcd_overlay_item_t item[LCD_OVERLAY_MAX_ITEMS];
+    lcd_rect_t prev_bounds[LCD_OVERLAY_MAX_ITEMS];
+    lcd_font_t font;
+} lcd_overlay_t;
+
+int lcd_overlay_init(lcd_overlay_t* overlay);
+/* Start a new frame's item list */
+void lcd_overlay_clear(lcd_overlay_t* overlay);
+int lcd_overlay_add_box(lcd_overlay_t* overlay, int16_t x1, int16_t y1, int16_t x2, int16_t y2, lcd_overlay_type_t type,
+                        uint8_t thickness, uint16_t color);
+int lcd_overlay_add_text(lcd_overlay_t* overlay, int16_t x, int16_t y, const char* text, uint16_t color);
+/* Report the areas covered by this and the previous frame's items */
+void lcd_overlay_mark_dirty(lcd_overlay_t* overlay, lcd_dirty_t* dirty);
+/* Send rect of a frame in GRAM layout to the panel with the items drawn over it */
+void lcd_overlay_stream(lcd_overlay_t* overlay, const uint32_t* gram, uint16_t gram_width, const lcd_rect_t* rect);
+
+#endif
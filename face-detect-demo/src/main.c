@@ -1,9 +1,16 @@
+#include "auto_exposure.h"
 #include "board_config.h"
 #include "bsp.h"
+#include "camera_profile.h"
 #include "dvp.h"
+#include "dvp_capture.h"
 #include "fpioa.h"
+#include "frame_stats.h"
 #include "gpiohs.h"
 #include "lcd.h"
+#include "lcd_dirty.h"
+#include "lcd_overlay.h"
+#include "motion_detect.h"
 #include "nt35310.h"
 #include "plic.h"
 #include "sysctl.h"
@@ -36,8 +43,55 @@
 #define PLL1_OUTPUT_FREQ 400000000UL
 
 volatile uint32_t g_ai_done_flag;
-volatile uint8_t g_dvp_finish_flag;
-static image_t kpu_image, display_image;
+/* One slot is being shown, one filled by the DVP and one holds the newest spare frame */
+#define CAPTURE_SLOTS 3
+/* The model input size; frames of other profiles are shown but not searched */
+#define DETECT_WIDTH 320
+#define DETECT_HEIGHT 240
+/* Skip the model while the scene is static, but still run it every MOTION_REFRESH frames */
+#define MOTION_DECIMATION 4
+#define MOTION_BLOCK 4
+#define MOTION_THRESHOLD 6
+#define MOTION_REFRESH 30
+/* Outline the regions that changed */
+#define SHOW_MOTION_ROIS 0
+/* Exposure statistics sample every AE_STEP-th pixel; the loop runs every AE_INTERVAL frames so settings land first */
+#define AE_STEP 8
+#define AE_INTERVAL 2
+/* Capture format at start-up */
+#define CAPTURE_PROFILE camera_profile_qvga
+/*
+ * DVP_CAPTURE_LUMA drops the AI output for single-channel models; motion and
+ * exposure then read the luma plane, and the RGB face model is skipped.
+ * Motion ROIs are in luma pixels, so keep LUMA_STEP at 1 to draw them.
+ */
+#define CAPTURE_FORMAT DVP_CAPTURE_RGB
+#define LUMA_STEP 1
+static lcd_dirty_t lcd_dirty;
+static lcd_overlay_t lcd_overlay;
+static motion_detect_t motion;
+static frame_stats_t frame_stats;
+#if (BOARD_VERSION == BOARD_V1_3)
+#define CAMERA_COUNT 2
+#else
+#define CAMERA_COUNT 1
+#endif
+/* Indexed by the camera frames are tagged with */
+static auto_exposure_t auto_exposure[CAMERA_COUNT];
+static uint32_t exposure_frames[CAMERA_COUNT];
+static uint32_t idle_frames;
+static uint32_t inferences;
+
+#if (BOARD_VERSION == BOARD_V1_3)
+/*
+ * Alternate both sensors frame by frame: faces are searched in the IR
+ * camera's frames while the color camera's frames are shown, each at its
+ * own rate. Off, the key switches between the cameras instead.
+ */
+#define INTERLEAVED_CAPTURE 0
+#define DETECT_CAMERA 0
+#define DISPLAY_CAMERA 1
+#endif
 
 kpu_model_context_t face_detect_task;
 static region_layer_t face_detect_rl;
@@ -57,30 +111,35 @@ INCBIN(model, "detect.kmodel");
 
 #if (BOARD_VERSION == BOARD_V1_3)
 uint8_t g_camera_no = 0;
+/* A long key press steps through these */
+static camera_profile_t profile_roi;
+static const camera_profile_t* profiles[] = {&CAPTURE_PROFILE, &camera_profile_qqvga, &profile_roi};
+static uint8_t profile_no = 0;
 
 void camera_switch(void) {
     g_camera_no = !g_camera_no;
     g_camera_no ? open_gc0328_0() : open_gc0328_1();
+    /* Frames are tagged with the sensor they come from */
+    dvp_capture_set_camera(g_camera_no ? 0 : 1);
 
     int enable = g_camera_no ? 1 : 0;
     pwm_set_enable(1, 1, enable);
 }
 #endif
 
-static void ai_done(void* ctx) {
-    g_ai_done_flag = 1;
+#if INTERLEAVED_CAPTURE
+/* Frames are tagged with the new camera only once its outputs are really on */
+static void camera_switched(sensor_bus_batch_t* batch, void* ctx) {
+    dvp_capture_switched((uint8_t)(uintptr_t)ctx, batch->state == SENSOR_BUS_DONE);
 }
 
-static int dvp_irq(void* ctx) {
-    if (dvp_get_interrupt(DVP_STS_FRAME_FINISH)) {
-        dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 0);
-        dvp_clear_interrupt(DVP_STS_FRAME_FINISH);
-        g_dvp_finish_flag = 1;
-    } else {
-        dvp_start_convert();
-        dvp_clear_interrupt(DVP_STS_FRAME_START);
-    }
-    return 0;
+static int camera_select(uint8_t camera, void* ctx) {
+    return gc0328_select_output(camera, camera_switched, (void*)(uintptr_t)camera);
+}
+#endif
+
+static void ai_done(void* ctx) {
+    g_ai_done_flag = 1;
 }
 
 static void io_init(void) {
@@ -131,58 +190,68 @@ static void io_set_power(void) {
     sysctl_set_power_mode(SYSCTL_POWER_BANK7, SYSCTL_POWER_V18);
 }
 
-static void draw_edge(uint32_t* gram, obj_info_t* obj_info, uint32_t index, uint16_t color) {
-    uint32_t data = ((uint32_t)color << 16) | (uint32_t)color;
-    uint32_t *addr1, *addr2, *addr3, *addr4, x1, y1, x2, y2;
-
-    x1 = obj_info->obj[index].x1;
-    y1 = obj_info->obj[index].y1;
-    x2 = obj_info->obj[index].x2;
-    y2 = obj_info->obj[index].y2;
-
-    if (x1 <= 0)
-        x1 = 1;
-    if (x2 >= 319)
-        x2 = 318;
-    if (y1 <= 0)
-        y1 = 1;
-    if (y2 >= 239)
-        y2 = 238;
-
-    addr1 = gram + (320 * y1 + x1) / 2;
-    addr2 = gram + (320 * y1 + x2 - 8) / 2;
-    addr3 = gram + (320 * (y2 - 1) + x1) / 2;
-    addr4 = gram + (320 * (y2 - 1) + x2 - 8) / 2;
-    for (uint32_t i = 0; i < 4; i++) {
-        *addr1 = data;
-        *(addr1 + 160) = data;
-        *addr2 = data;
-        *(addr2 + 160) = data;
-        *addr3 = data;
-        *(addr3 + 160) = data;
-        *addr4 = data;
-        *(addr4 + 160) = data;
-        addr1++;
-        addr2++;
-        addr3++;
-        addr4++;
+/* Stop capture, switch the whole pipeline to the profile and start again */
+static void capture_set_profile(const camera_profile_t* profile, dvp_frame_t** shown) {
+    struct _lcd_overlay* overlay = lcd_dirty.overlay;
+    const camera_profile_t* active;
+
+    lcd_wait_idle();
+    if (*shown) {
+        dvp_capture_release(*shown);
+        *shown = NULL;
     }
-    addr1 = gram + (320 * y1 + x1) / 2;
-    addr2 = gram + (320 * y1 + x2 - 2) / 2;
-    addr3 = gram + (320 * (y2 - 8) + x1) / 2;
-    addr4 = gram + (320 * (y2 - 8) + x2 - 2) / 2;
-    for (uint32_t i = 0; i < 8; i++) {
-        *addr1 = data;
-        *addr2 = data;
-        *addr3 = data;
-        *addr4 = data;
-        addr1 += 160;
-        addr2 += 160;
-        addr3 += 160;
-        addr4 += 160;
+    dvp_capture_stop();
+    if (camera_profile_apply(profile) != 0)
+        printf("profile %s not supported\n", profile->name);
+    active = camera_profile_get();
+    dvp_capture_start();
+
+    /* The new frame may not cover the old one */
+    lcd_clear(BLACK);
+    lcd_dirty_init(&lcd_dirty, NULL, active->out_width, active->out_height);
+    lcd_dirty_set_overlay(&lcd_dirty, overlay);
+    printf("profile %s: %ux%u\n", active->name, active->out_width, active->out_height);
+}
+
+/* The image motion and exposure statistics sample */
+static const image_t* frame_input(dvp_frame_t* frame) {
+    return CAPTURE_FORMAT == DVP_CAPTURE_LUMA ? dvp_capture_luma(frame) : &frame->ai;
+}
+
+/* exposure follows the captured frames, no sensor round trip needed */
+static void track_exposure(dvp_frame_t* frame) {
+    if (exposure_frames[frame->camera]++ % AE_INTERVAL == 0) {
+        frame_stats_compute(&frame_stats, frame_input(frame), AE_STEP);
+        auto_exposure_update(&auto_exposure[frame->camera], &frame_stats);
+    }
+}
+
+/* Search the frame for faces unless nothing moved; a static scene keeps the previous result */
+static void detect_faces(dvp_frame_t* frame) {
+    uint16_t moved = motion_detect_run(&motion, frame_input(frame));
+
+    if (CAPTURE_FORMAT != DVP_CAPTURE_RGB || frame->ai.width != DETECT_WIDTH || frame->ai.height != DETECT_HEIGHT) {
+        face_detect_info.obj_number = 0;
+    } else if (moved || ++idle_frames >= MOTION_REFRESH) {
+        idle_frames = 0;
+        inferences++;
+        g_ai_done_flag = 0;
+        kpu_run_kmodel(&face_detect_task, frame->ai.addr, DMAC_CHANNEL5, ai_done, NULL);
+        while (!g_ai_done_flag)
+            ;
+        float* output;
+        size_t output_size;
+        kpu_get_output(&face_detect_task, 0, (uint8_t**)&output, &output_size);
+        face_detect_rl.input = output;
+        region_layer_run(&face_detect_rl, &face_detect_info);
     }
 }
 
+static void draw_edge(lcd_overlay_t* overlay, obj_info_t* obj_info, uint32_t index, uint16_t color) {
+    lcd_overlay_add_box(overlay, obj_info->obj[index].x1, obj_info->obj[index].y1, obj_info->obj[index].x2,
+                        obj_info->obj[index].y2, LCD_OVERLAY_CORNERS, 2, color);
+}
+
 int main(void) {
     /* Set CPU and dvp clk */
     sysctl_pll_set_freq(SYSCTL_PLL0, PLL0_OUTPUT_FREQ);
@@ -208,6 +277,10 @@ int main(void) {
     lcd_init();
     lcd_set_direction(DIR_YX_RLDU);
     lcd_clear(BLACK);
+    tft_stats_t tft_stats;
+    tft_get_stats(&tft_stats);
+    printf("LCD transfers %u, SPI reconfigs %u, %lu cycles in setup\n", tft_stats.transfers, tft_stats.reconfigs,
+           (unsigned long)tft_stats.config_cycles);
     /* DVP init */
     printf("DVP init\n");
     dvp_init(8);
@@ -222,26 +295,38 @@ int main(void) {
 #elif (BOARD_VERSION == BOARD_V1_3)
     gc0328_init();
     open_gc0328_1();
+    dvp_capture_set_camera(1);
 #endif
+    for (uint8_t camera = 0; camera < CAMERA_COUNT; camera++)
+        auto_exposure_init(&auto_exposure[camera], camera, AUTO_EXPOSURE_TARGET);
 
-    kpu_image.pixel = 3;
-    kpu_image.width = 320;
-    kpu_image.height = 240;
-    image_init(&kpu_image);
-    display_image.pixel = 2;
-    display_image.width = 320;
-    display_image.height = 240;
-    image_init(&display_image);
-    dvp_set_ai_addr((uint32_t)kpu_image.addr, (uint32_t)(kpu_image.addr + 320 * 240),
-                    (uint32_t)(kpu_image.addr + 320 * 240 * 2));
-    dvp_set_display_addr((uint32_t)display_image.addr);
-    dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 0);
-    dvp_disable_auto();
     /* DVP interrupt config */
     printf("DVP interrupt config\n");
-    plic_set_priority(IRQN_DVP_INTERRUPT, 1);
-    plic_irq_register(IRQN_DVP_INTERRUPT, dvp_irq, NULL);
-    plic_irq_enable(IRQN_DVP_INTERRUPT);
+    /* Sized for the largest profile */
+#if INTERLEAVED_CAPTURE
+    int capture_ret = dvp_capture_init_interleaved(CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, CAPTURE_SLOTS, CAMERA_COUNT,
+                                                   camera_select, NULL);
+    /* The IR camera needs its light for every other frame now */
+    pwm_set_enable(1, 1, 1);
+#else
+    int capture_ret = dvp_capture_init(CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, CAPTURE_SLOTS);
+#endif
+    if (capture_ret == 0)
+        capture_ret = dvp_capture_set_format(CAPTURE_FORMAT, LUMA_STEP);
+    if (capture_ret != 0) {
+        printf("\ncapture init error\n");
+        while (1)
+            ;
+    }
+    if (motion_detect_init(&motion, CAMERA_VIEW_WIDTH, CAMERA_VIEW_HEIGHT, MOTION_DECIMATION, MOTION_BLOCK,
+                           MOTION_THRESHOLD) != 0) {
+        printf("\nmotion init error\n");
+        while (1)
+            ;
+    }
+    lcd_dirty_init(&lcd_dirty, NULL, 320, 240);
+    if (lcd_overlay_init(&lcd_overlay) == 0)
+        lcd_dirty_set_overlay(&lcd_dirty, &lcd_overlay);
     /* init face detect model */
     if (kpu_load_kmodel(&face_detect_task, model_data_align) != 0) {
         printf("\nmodel init error\n");
@@ -252,43 +337,89 @@ int main(void) {
     face_detect_rl.anchor = anchor;
     face_detect_rl.threshold = 0.7;
     face_detect_rl.nms_value = 0.3;
-    region_layer_init(&face_detect_rl, 20, 15, 30, kpu_image.width, kpu_image.height);
+    region_layer_init(&face_detect_rl, 20, 15, 30, DETECT_WIDTH, DETECT_HEIGHT);
     /* enable global interrupt */
     sysctl_enable_irq();
 
 #if (BOARD_VERSION == BOARD_V1_3)
     tick_init(TICK_NANOSECONDS);
+    camera_profile_roi(&profile_roi, 80, 60, 160, 120);
 #endif
 
     /* system start */
     printf("System start\n");
+    dvp_frame_t* shown = NULL;
+    uint32_t frames_shown = 0;
+    capture_set_profile(&CAPTURE_PROFILE, &shown);
     while (1) {
 #if (BOARD_VERSION == BOARD_V1_3)
-        if (KEY_PRESS == key_get()) {
+        uint8_t key = key_get();
+
+        if (KEY_PRESS == key && !INTERLEAVED_CAPTURE) {
             camera_switch();
+        } else if (KEY_LONGPRESS == key) {
+            profile_no = (profile_no + 1) % (sizeof(profiles) / sizeof(profiles[0]));
+            capture_set_profile(profiles[profile_no], &shown);
         }
 #endif
 
-        g_dvp_finish_flag = 0;
-        dvp_clear_interrupt(DVP_STS_FRAME_START | DVP_STS_FRAME_FINISH);
-        dvp_config_interrupt(DVP_CFG_START_INT_ENABLE | DVP_CFG_FINISH_INT_ENABLE, 1);
-        while (g_dvp_finish_flag == 0)
-            ;
-        /* run face detect */
-        g_ai_done_flag = 0;
-        kpu_run_kmodel(&face_detect_task, kpu_image.addr, DMAC_CHANNEL5, ai_done, NULL);
-        while (!g_ai_done_flag)
-            ;
-        float* output;
-        size_t output_size;
-        kpu_get_output(&face_detect_task, 0, (uint8_t**)&output, &output_size);
-        face_detect_rl.input = output;
-        region_layer_run(&face_detect_rl, &face_detect_info);
+        /* the DVP keeps capturing into the ring while this frame is processed */
+#if INTERLEAVED_CAPTURE
+        dvp_frame_t* frame = dvp_capture_acquire_camera(DISPLAY_CAMERA, 1);
+        dvp_frame_t* detect_frame = dvp_capture_acquire_camera(DETECT_CAMERA, 0);
+
+        track_exposure(frame);
+        if (detect_frame) {
+            track_exposure(detect_frame);
+            detect_faces(detect_frame);
+            dvp_capture_release(detect_frame);
+        }
+#else
+        dvp_frame_t* frame = dvp_capture_acquire(1);
+
+        track_exposure(frame);
+        detect_faces(frame);
+#endif
+
+        lcd_overlay_clear(&lcd_overlay);
         /* run key point detect */
         for (uint32_t face_cnt = 0; face_cnt < face_detect_info.obj_number; face_cnt++) {
-            draw_edge((uint32_t*)display_image.addr, &face_detect_info, face_cnt, RED);
+            draw_edge(&lcd_overlay, &face_detect_info, face_cnt, RED);
+        }
+#if SHOW_MOTION_ROIS
+        for (uint8_t i = 0; i < motion.roi_count; i++) {
+            lcd_overlay_add_box(&lcd_overlay, motion.roi[i].x1, motion.roi[i].y1, motion.roi[i].x2, motion.roi[i].y2,
+                                LCD_OVERLAY_RECT, 1, YELLOW);
+        }
+#endif
+        /* display result, sending only what changed since the last frame with the boxes drawn over it */
+        lcd_dirty_set_gram(&lcd_dirty, (uint32_t*)frame->display.addr);
+        lcd_dirty_diff(&lcd_dirty);
+        /* the previous frame may still be streaming until the LCD is idle */
+        lcd_wait_idle();
+        if (shown)
+            dvp_capture_release(shown);
+        lcd_dirty_flush(&lcd_dirty);
+        shown = frame;
+
+        if ((++frames_shown & 63) == 0) {
+            dvp_capture_stats_t stats;
+
+            dvp_capture_get_stats(&stats);
+            printf("cam %u: %.1f fps, interval %u-%u us, readout %u us, dropped %u of %u\n", frame->camera,
+                   stats.fps, stats.interval_min_us, stats.interval_max_us, stats.readout_us, stats.dropped,
+                   stats.captured);
+#if INTERLEAVED_CAPTURE
+            printf("interleaved: %u/%u frames per camera, %u switches deferred, %u frames torn\n",
+                   stats.camera_frames[0], stats.camera_frames[1], stats.switch_deferred, stats.switch_torn);
+#endif
+            printf("model ran on %u of 64 frames, motion check %lu us\n", inferences,
+                   (unsigned long)(motion.cycles / (sysctl_clock_get_freq(SYSCTL_CLOCK_CPU) / 1000000)));
+            inferences = 0;
+            auto_exposure_t* ae = &auto_exposure[frame->camera];
+            printf("luma %u, exposure %u gain %u wb %u/%u, %u sensor updates, %u deferred, %u rolled back\n",
+                   frame_stats.mean, ae->exposure, ae->gain, ae->wb_r, ae->wb_b, ae->updates, ae->deferred,
+                   ae->rollbacks);
         }
-        /* display result */
-        lcd_draw_picture(0, 0, 320, 240, (uint32_t*)display_image.addr);
     }
 }
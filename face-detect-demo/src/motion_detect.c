@@ -0,0 +1,193 @@
+#include "motion_detect.h"
+#include "encoding.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MAP_CHANGED 1
+#define MAP_VISITED 2
+
+int motion_detect_init(motion_detect_t* motion, uint16_t max_width, uint16_t max_height, uint8_t decimation,
+                       uint8_t block, uint8_t threshold) {
+    uint16_t cols, rows;
+    uint32_t blocks;
+
+    if (decimation == 0 || block == 0)
+        return -1;
+    cols = max_width / decimation;
+    rows = max_height / decimation;
+    blocks = (uint32_t)((cols + block - 1) / block) * ((rows + block - 1) / block);
+
+    memset(motion, 0, sizeof(*motion));
+    motion->decimation = decimation;
+    motion->block = block;
+    motion->threshold = threshold;
+    motion->max_width = max_width;
+    motion->max_height = max_height;
+    motion->luma = malloc((uint32_t)cols * rows);
+    motion->sad = malloc(((cols + block - 1) / block) * sizeof(uint32_t));
+    motion->stack = malloc(blocks * sizeof(uint16_t));
+    motion->map = malloc(blocks);
+    if (!motion->luma || !motion->sad || !motion->stack || !motion->map) {
+        motion_detect_deinit(motion);
+        return -1;
+    }
+    return 0;
+}
+
+void motion_detect_deinit(motion_detect_t* motion) {
+    free(motion->luma);
+    free(motion->sad);
+    free(motion->stack);
+    free(motion->map);
+    motion->luma = NULL;
+    motion->sad = NULL;
+    motion->stack = NULL;
+    motion->map = NULL;
+}
+
+static void motion_add_roi(motion_detect_t* motion, const motion_roi_t* r) {
+    motion_roi_t* last;
+
+    if (motion->roi_count < MOTION_MAX_ROIS) {
+        motion->roi[motion->roi_count++] = *r;
+        return;
+    }
+    /* Out of slots: grow the last ROI to cover the rest */
+    last = &motion->roi[MOTION_MAX_ROIS - 1];
+    if (r->x1 < last->x1)
+        last->x1 = r->x1;
+    if (r->y1 < last->y1)
+        last->y1 = r->y1;
+    if (r->x2 > last->x2)
+        last->x2 = r->x2;
+    if (r->y2 > last->y2)
+        last->y2 = r->y2;
+}
+
+/* Flood-fill connected changed blocks into bounding boxes in frame pixels */
+static void motion_find_rois(motion_detect_t* motion) {
+    uint16_t bx_count = motion->blocks_x;
+    uint32_t blocks = (uint32_t)bx_count * motion->blocks_y;
+    uint16_t span = motion->block * motion->decimation;
+
+    motion->roi_count = 0;
+    for (uint32_t seed = 0; seed < blocks; seed++) {
+        uint16_t top = 0;
+        uint16_t bx1 = UINT16_MAX, by1 = UINT16_MAX, bx2 = 0, by2 = 0;
+        motion_roi_t r;
+
+        if (motion->map[seed] != MAP_CHANGED)
+            continue;
+        motion->map[seed] = MAP_VISITED;
+        motion->stack[top++] = seed;
+        while (top) {
+            uint16_t i = motion->stack[--top];
+            uint16_t bx = i % bx_count, by = i / bx_count;
+            uint16_t next[4];
+            uint8_t n = 0;
+
+            bx1 = bx < bx1 ? bx : bx1;
+            by1 = by < by1 ? by : by1;
+            bx2 = bx > bx2 ? bx : bx2;
+            by2 = by > by2 ? by : by2;
+            if (bx > 0)
+                next[n++] = i - 1;
+            if (bx + 1 < bx_count)
+                next[n++] = i + 1;
+            if (by > 0)
+                next[n++] = i - bx_count;
+            if (by + 1 < motion->blocks_y)
+                next[n++] = i + bx_count;
+            for (uint8_t k = 0; k < n; k++) {
+                if (motion->map[next[k]] == MAP_CHANGED) {
+                    motion->map[next[k]] = MAP_VISITED;
+                    motion->stack[top++] = next[k];
+                }
+            }
+        }
+
+        r.x1 = bx1 * span;
+        r.y1 = by1 * span;
+        r.x2 = (bx2 + 1) * span - 1;
+        r.y2 = (by2 + 1) * span - 1;
+        if (r.x2 >= motion->width)
+            r.x2 = motion->width - 1;
+        if (r.y2 >= motion->height)
+            r.y2 = motion->height - 1;
+        motion_add_roi(motion, &r);
+    }
+    for (uint32_t i = 0; i < blocks; i++)
+        motion->map[i] = motion->map[i] ? MAP_CHANGED : 0;
+}
+
+uint16_t motion_detect_run(motion_detect_t* motion, const image_t* frame) {
+    uint64_t start = read_cycle();
+    uint8_t dec = motion->decimation;
+    uint8_t block = motion->block;
+    uint16_t cols = frame->width / dec;
+    uint16_t rows = frame->height / dec;
+    uint32_t plane = (uint32_t)frame->width * frame->height;
+    const uint8_t* r = frame->addr;
+    const uint8_t* g = r + plane;
+    const uint8_t* b = g + plane;
+    int luma_only = frame->format == IMAGE_FORMAT_LUMA;
+    int fresh = frame->width != motion->width || frame->height != motion->height;
+
+    if (frame->width > motion->max_width || frame->height > motion->max_height)
+        return 0;
+
+    motion->width = frame->width;
+    motion->height = frame->height;
+    motion->blocks_x = (cols + block - 1) / block;
+    motion->blocks_y = (rows + block - 1) / block;
+    motion->changed = 0;
+
+    for (uint16_t by = 0; by < motion->blocks_y; by++) {
+        uint16_t y_end = (by + 1) * block < rows ? (by + 1) * block : rows;
+        uint8_t* map = motion->map + by * motion->blocks_x;
+
+        memset(motion->sad, 0, motion->blocks_x * sizeof(uint32_t));
+        for (uint16_t y = by * block; y < y_end; y++) {
+            uint32_t src = (uint32_t)y * dec * frame->width;
+            uint8_t* luma = motion->luma + y * cols;
+
+            for (uint16_t x = 0; x < cols; x++, src += dec) {
+                uint8_t v = luma_only ? r[src] : (r[src] + 2 * g[src] + b[src]) >> 2;
+                int16_t d = v - luma[x];
+
+                motion->sad[x / block] += d < 0 ? -d : d;
+                luma[x] = v;
+            }
+        }
+        for (uint16_t bx = 0; bx < motion->blocks_x; bx++) {
+            uint16_t x_end = (bx + 1) * block < cols ? (bx + 1) * block : cols;
+            uint32_t samples = (uint32_t)(x_end - bx * block) * (y_end - by * block);
+
+            map[bx] = fresh || motion->sad[bx] > samples * motion->threshold;
+            motion->changed += map[bx];
+        }
+    }
+    motion_find_rois(motion);
+
+    motion->cycles = read_cycle() - start;
+    return motion->changed;
+}
+
+int motion_detect_overlaps(const motion_detect_t* motion, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
+    uint16_t span = motion->block * motion->decimation;
+
+    /* Nothing to compare with yet */
+    if (motion->width == 0)
+        return 1;
+    if (x2 >= motion->width)
+        x2 = motion->width - 1;
+    if (y2 >= motion->height)
+        y2 = motion->height - 1;
+    for (uint16_t by = y1 / span; by <= y2 / span && by < motion->blocks_y; by++) {
+        for (uint16_t bx = x1 / span; bx <= x2 / span && bx < motion->blocks_x; bx++) {
+            if (motion->map[by * motion->blocks_x + bx])
+                return 1;
+        }
+    }
+    return 0;
+}
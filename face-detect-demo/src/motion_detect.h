@@ -0,0 +1,61 @@
+#ifndef _MOTION_DETECT_H_
+#define _MOTION_DETECT_H_
+
+#include <stdint.h>
+#include "image_process.h"
+
+/* clang-format off */
+#define MOTION_MAX_ROIS     8
+/* clang-format on */
+
+typedef struct _motion_roi {
+    uint16_t x1;
+    uint16_t y1;
+    uint16_t x2;
+    uint16_t y2;
+} motion_roi_t;
+
+/*
+ * Frame differencing on a decimated luma plane. Every decimation-th pixel of
+ * the planar AI frame in both directions is reduced to (R + 2G + B) / 4 and
+ * compared with the same sample of the previous frame; a luma image is
+ * sampled as it is. Samples are grouped into block x block tiles, and a tile
+ * whose mean absolute difference exceeds threshold is marked in map.
+ * Connected marked tiles become ROIs in frame pixels.
+ *
+ * A 320x240 frame at decimation 4 is 4800 samples, a small fraction of one
+ * inference. The first frame, and the first after a size change, counts as
+ * motion everywhere.
+ */
+typedef struct _motion_detect {
+    uint8_t decimation;
+    uint8_t block;
+    uint8_t threshold;
+    uint16_t width;
+    uint16_t height;
+    uint16_t blocks_x;
+    uint16_t blocks_y;
+    /* Previous frame's samples, then the current ones after motion_detect_run */
+    uint8_t* luma;
+    uint32_t* sad;
+    uint16_t* stack;
+    uint8_t* map;
+    /* Largest frame the buffers were sized for */
+    uint16_t max_width;
+    uint16_t max_height;
+    uint16_t changed;
+    uint8_t roi_count;
+    motion_roi_t roi[MOTION_MAX_ROIS];
+    uint32_t cycles;
+} motion_detect_t;
+
+/* Buffers are sized for frames up to max_width x max_height; motion_detect_run skips larger ones */
+int motion_detect_init(motion_detect_t* motion, uint16_t max_width, uint16_t max_height, uint8_t decimation,
+                       uint8_t block, uint8_t threshold);
+void motion_detect_deinit(motion_detect_t* motion);
+/* Compare a planar or luma frame with the previous one; returns the number of changed blocks */
+uint16_t motion_detect_run(motion_detect_t* motion, const image_t* frame);
+/* Whether any changed block intersects the given frame rectangle */
+int motion_detect_overlaps(const motion_detect_t* motion, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+
+#endif
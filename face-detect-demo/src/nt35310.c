@@ -17,6 +17,37 @@
 #include "spi.h"
 #include "unistd.h"
 #include "board_config.h"
+#include "encoding.h"
+
+/* The DMA interrupt ends transfers on the board; a host model moves them on from here */
+#ifndef SPI_DMA_POLL
+#define SPI_DMA_POLL()
+#endif
+
+static volatile uint8_t g_tft_busy;
+static plic_irq_callback_t g_tft_callback;
+static void *g_tft_ctx;
+
+static int tft_dma_done(void *ctx)
+{
+    (void)ctx;
+    g_tft_busy = 0;
+    if (g_tft_callback)
+        g_tft_callback(g_tft_ctx);
+    return 0;
+}
+
+int tft_is_busy(void)
+{
+    SPI_DMA_POLL();
+    return g_tft_busy;
+}
+
+void tft_wait_idle(void)
+{
+    while (g_tft_busy)
+        SPI_DMA_POLL();
+}
 
 static void  init_dcx(void)
 {
@@ -43,6 +74,58 @@ static void init_rst(void)
     usleep(100000);
 }
 
+/* SPI frame setup last programmed into the controller, 0 when unknown */
+static struct
+{
+    uint8_t data_bit_length;
+    uint8_t instruction_length;
+    uint8_t address_length;
+} g_tft_spi_config;
+
+static tft_stats_t g_tft_stats;
+
+/* Reprogram SPI0 only when the frame layout differs from the previous transfer */
+static void tft_spi_config(uint8_t data_bit_length, uint8_t instruction_length, uint8_t address_length)
+{
+    uint64_t start = read_cycle();
+
+    if (g_tft_spi_config.data_bit_length == data_bit_length &&
+        g_tft_spi_config.instruction_length == instruction_length &&
+        g_tft_spi_config.address_length == address_length)
+    {
+        g_tft_stats.config_cycles += read_cycle() - start;
+        return;
+    }
+
+    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, data_bit_length, 0);
+    spi_init_non_standard(SPI_CHANNEL, instruction_length, address_length, 0/*wait cycles*/,
+                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
+    g_tft_spi_config.data_bit_length = data_bit_length;
+    g_tft_spi_config.instruction_length = instruction_length;
+    g_tft_spi_config.address_length = address_length;
+    g_tft_stats.reconfigs++;
+    g_tft_stats.config_cycles += read_cycle() - start;
+}
+
+/*
+ * Short byte sequences are widened into a stack buffer and sent as 32-bit
+ * DMA beats, sparing the SDK its per-transfer malloc for SPI_TRANS_CHAR.
+ */
+static void tft_send_bytes(uint8_t *data_buf, uint32_t length)
+{
+    uint32_t buf[TFT_BATCH_MAX];
+
+    g_tft_stats.transfers++;
+    if (length > TFT_BATCH_MAX)
+    {
+        spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT, data_buf, length, SPI_TRANS_CHAR);
+        return;
+    }
+    for (uint32_t i = 0; i < length; i++)
+        buf[i] = data_buf[i];
+    spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT, buf, length, SPI_TRANS_INT);
+}
+
 void tft_hard_init(void)
 {
     init_dcx();
@@ -50,51 +133,114 @@ void tft_hard_init(void)
     spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 8, 0);
     init_rst();
     spi_set_clk_rate(SPI_CHANNEL, 18000000);
+    tft_spi_invalidate();
+}
+
+void tft_spi_invalidate(void)
+{
+    g_tft_spi_config.data_bit_length = 0;
+}
+
+void tft_get_stats(tft_stats_t *stats)
+{
+    *stats = g_tft_stats;
+}
+
+void tft_reset_stats(void)
+{
+    g_tft_stats.transfers = 0;
+    g_tft_stats.reconfigs = 0;
+    g_tft_stats.config_cycles = 0;
 }
 
 void tft_write_command(uint8_t cmd)
 {
+    tft_wait_idle();
     set_dcx_control();
-    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 8, 0);
-    spi_init_non_standard(SPI_CHANNEL, 8/*instrction length*/, 0/*address length*/, 0/*wait cycles*/,
-                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
-    spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT, (uint8_t *)(&cmd), 1,SPI_TRANS_CHAR);
+    tft_spi_config(8, 8/*instrction length*/, 0/*address length*/);
+    tft_send_bytes(&cmd, 1);
 }
 
 void tft_write_byte(uint8_t *data_buf, uint32_t length)
 {
+    tft_wait_idle();
     set_dcx_data();
-    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 8, 0);
-    spi_init_non_standard(SPI_CHANNEL, 8/*instrction length*/, 0/*address length*/, 0/*wait cycles*/,
-                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
-    spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT, data_buf, length, SPI_TRANS_CHAR);
+    tft_spi_config(8, 8/*instrction length*/, 0/*address length*/);
+    tft_send_bytes(data_buf, length);
+}
+
+void tft_write_commands(const tft_command_t *commands, uint32_t count)
+{
+    /* One wait and one frame setup for the whole sequence; only DCX changes between the sends */
+    tft_wait_idle();
+    tft_spi_config(8, 8/*instrction length*/, 0/*address length*/);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        set_dcx_control();
+        tft_send_bytes((uint8_t *)&commands[i].cmd, 1);
+        if (commands[i].length)
+        {
+            set_dcx_data();
+            tft_send_bytes((uint8_t *)commands[i].data, commands[i].length);
+        }
+    }
+}
+
+void tft_write_command_data(uint8_t cmd, uint8_t *data_buf, uint32_t length)
+{
+    tft_command_t command = {.cmd = cmd, .data = data_buf, .length = length};
+
+    tft_write_commands(&command, 1);
 }
 
 void tft_write_half(uint16_t *data_buf, uint32_t length)
 {
+    tft_wait_idle();
     set_dcx_data();
-    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 16, 0);
-    spi_init_non_standard(SPI_CHANNEL, 16/*instrction length*/, 0/*address length*/, 0/*wait cycles*/,
-                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
+    tft_spi_config(16, 16/*instrction length*/, 0/*address length*/);
+    g_tft_stats.transfers++;
     spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT,data_buf, length, SPI_TRANS_SHORT);
 }
 
 void tft_write_word(uint32_t *data_buf, uint32_t length, uint32_t flag)
 {
+    (void)flag;
+    tft_wait_idle();
     set_dcx_data();
-    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 32, 0);
-
-    spi_init_non_standard(SPI_CHANNEL, 0/*instrction length*/, 32/*address length*/, 0/*wait cycles*/,
-                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
+    tft_spi_config(32, 0/*instrction length*/, 32/*address length*/);
+    g_tft_stats.transfers++;
     spi_send_data_normal_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT,data_buf, length, SPI_TRANS_INT);
 }
 
 void tft_fill_data(uint32_t *data_buf, uint32_t length)
 {
+    tft_wait_idle();
     set_dcx_data();
-    spi_init(SPI_CHANNEL, SPI_WORK_MODE_0, SPI_FF_OCTAL, 32, 0);
-    spi_init_non_standard(SPI_CHANNEL, 0/*instrction length*/, 32/*address length*/, 0/*wait cycles*/,
-                          SPI_AITM_AS_FRAME_FORMAT/*spi address trans mode*/);
+    tft_spi_config(32, 0/*instrction length*/, 32/*address length*/);
+    g_tft_stats.transfers++;
     spi_fill_data_dma(DMAC_CHANNEL0, SPI_CHANNEL, SPI_SLAVE_SELECT,data_buf, length);
 }
 
+void tft_write_word_async(uint32_t *data_buf, uint32_t length, plic_irq_callback_t callback, void *ctx)
+{
+    spi_data_t data = {
+        .tx_channel = DMAC_CHANNEL0,
+        .tx_buf = data_buf,
+        .tx_len = length,
+        .transfer_mode = SPI_TMOD_TRANS,
+    };
+    plic_interrupt_t irq = {
+        .callback = tft_dma_done,
+        .ctx = NULL,
+        .priority = 1,
+    };
+
+    tft_wait_idle();
+    set_dcx_data();
+    tft_spi_config(32, 0/*instrction length*/, 32/*address length*/);
+    g_tft_callback = callback;
+    g_tft_ctx = ctx;
+    g_tft_busy = 1;
+    g_tft_stats.transfers++;
+    spi_handle_data_dma(SPI_CHANNEL, SPI_SLAVE_SELECT, data, &irq);
+}
@@ -16,6 +16,7 @@
 #define _NT35310_H_
 
 #include <stdint.h>
+#include "plic.h"
 
 /* clang-format off */
 #define NO_OPERATION            0x00
@@ -96,14 +97,51 @@
 
 #define SPI_CHANNEL             0
 #define SPI_SLAVE_SELECT        3
+
+/* Longest byte sequence sent without the SDK's temporary buffer */
+#define TFT_BATCH_MAX           16
 /* clang-format on */
 
+/* One command and its parameter bytes */
+typedef struct _tft_command
+{
+    uint8_t cmd;
+    const uint8_t *data;
+    uint32_t length;
+} tft_command_t;
+
+typedef struct _tft_stats
+{
+    uint32_t transfers;
+    uint32_t reconfigs;
+    uint64_t config_cycles;
+} tft_stats_t;
+
 void tft_hard_init(void);
 void tft_write_command(uint8_t cmd);
 void tft_write_byte(uint8_t *data_buf, uint32_t length);
+void tft_write_command_data(uint8_t cmd, uint8_t *data_buf, uint32_t length);
+/*
+ * Send consecutive commands with their parameters under one SPI frame setup,
+ * e.g. the address window and memory write of lcd_set_area.
+ */
+void tft_write_commands(const tft_command_t *commands, uint32_t count);
 void tft_write_half(uint16_t *data_buf, uint32_t length);
 void tft_write_word(uint32_t *data_buf, uint32_t length, uint32_t flag);
 void tft_fill_data(uint32_t *data_buf, uint32_t length);
+/*
+ * Start a word transfer and return at once; callback runs from the DMA
+ * interrupt when the last word has left the SPI FIFO. Every other tft_write_*
+ * call waits for an outstanding transfer first.
+ */
+void tft_write_word_async(uint32_t *data_buf, uint32_t length, plic_irq_callback_t callback, void *ctx);
+int tft_is_busy(void);
+/* Force the next transfer to reprogram SPI0, e.g. after another user touched it */
+void tft_spi_invalidate(void);
+/* Transfers issued, SPI reconfigurations done and CPU cycles spent deciding/doing them */
+void tft_get_stats(tft_stats_t *stats);
+void tft_reset_stats(void);
+void tft_wait_idle(void);
 
 #endif
 
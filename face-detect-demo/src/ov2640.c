@@ -20,6 +20,8 @@
 #include "ov2640.h"
 #include "dvp.h"
 #include "plic.h"
+#include "sensor_bus.h"
+#include "sensor_regs.h"
 
 const uint8_t ov2640_config[][2]=
 {
@@ -211,21 +213,186 @@ const uint8_t ov2640_config[][2]=
     {0x00, 0x00}
 };
 
+/* The init table feeds the DSP an 800x600 window (HSIZE 0xC8, VSIZE 0x96, in units of 4) */
+#define OV2640_DSP_WIDTH    (0xC8 << 2)
+#define OV2640_DSP_HEIGHT   (0x96 << 2)
+
+static const sensor_bus_config_t ov2640_bus_config = {
+    .address = OV2640_ADDR,
+    .select = NULL,
+};
+
+static void ov2640_regs_write(void *ctx, uint8_t reg, uint8_t value)
+{
+    if (sensor_bus_record(0, reg, value) == 0)
+        return;
+    sensor_bus_lock();
+    dvp_sccb_send_data(OV2640_ADDR, reg, value);
+    sensor_bus_unlock();
+}
+
+static uint8_t ov2640_regs_read(void *ctx, uint8_t reg)
+{
+    uint8_t value;
+
+    /* Writes recorded so far must reach the sensor before this read */
+    sensor_bus_flush();
+    sensor_bus_lock();
+    value = dvp_sccb_receive_data(OV2640_ADDR, reg);
+    sensor_bus_unlock();
+    return value;
+}
+
+/* SDE, gamma and two DSP table windows, each behind an address register */
+static const uint8_t ov2640_ports[] = {0x7D, 0x91, 0x93, 0x97};
+
+/* 0xFF selects the DSP (0) or sensor (1) bank; COM7[7] in the sensor bank resets */
+static const sensor_regs_config_t ov2640_regs_config = {
+    .bank_reg = 0xFF,
+    .bank_mask = 0x01,
+    .reset_bank = 1,
+    .reset_reg = 0x12,
+    .reset_mask = 0x80,
+    .port_count = sizeof(ov2640_ports),
+    .ports = ov2640_ports,
+    .write = ov2640_regs_write,
+    .read = ov2640_regs_read,
+};
+
+static sensor_regs_t ov2640_regs;
+
+sensor_regs_t *ov2640_get_regs(void)
+{
+    return &ov2640_regs;
+}
+
 int ov2640_init(void)
 {
     uint16_t v_manuf_id;
     uint16_t v_device_id;
+    sensor_bus_init(&ov2640_bus_config);
+    sensor_regs_init(&ov2640_regs, &ov2640_regs_config, NULL);
     ov2640_read_id(&v_manuf_id, &v_device_id);
     printf("manuf_id:0x%04x,device_id:0x%04x\n", v_manuf_id, v_device_id);
-    uint16_t index = 0;
-    for (index = 0; ov2640_config[index][0]; index++)
-        dvp_sccb_send_data(OV2640_ADDR, ov2640_config[index][0], ov2640_config[index][1]);
+    /* The vendor sequence goes out as written, repeats included; it is not
+     * verified, since it resets the sensor and writes self-clearing bits */
+    sensor_regs_apply(&ov2640_regs, ov2640_config, SENSOR_REGS_FORCE);
+    printf("ov2640: %u register writes, %u skipped\n", ov2640_regs.stats.writes, ov2640_regs.stats.skipped);
+    return 0;
+}
+
+int ov2640_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t out_width,
+                      uint16_t out_height)
+{
+    /* The DSP input window in sensor pixels, scaled from the field of view */
+    uint16_t hsize = (uint32_t)width * OV2640_DSP_WIDTH / OV2640_VIEW_WIDTH;
+    uint16_t vsize = (uint32_t)height * OV2640_DSP_HEIGHT / OV2640_VIEW_HEIGHT;
+    uint16_t xoff = (uint32_t)x * OV2640_DSP_WIDTH / OV2640_VIEW_WIDTH;
+    uint16_t yoff = (uint32_t)y * OV2640_DSP_HEIGHT / OV2640_VIEW_HEIGHT;
+    uint16_t zmow = out_width / 4;
+    uint16_t zmoh = out_height / 4;
+
+    if (x + width > OV2640_VIEW_WIDTH || y + height > OV2640_VIEW_HEIGHT)
+        return -1;
+    if ((hsize & 3) || (vsize & 3) || (out_width & 3) || (out_height & 3))
+        return -1;
+    if (out_width == 0 || out_height == 0 || out_width > width || out_height > height)
+        return -1;
+
+    const uint8_t window[][2] =
+    {
+        {0xFF, 0x00},
+        {0xE0, 0x04},   // hold the DVP output while the window changes
+        {0x51, (hsize >> 2) & 0xFF},
+        {0x52, (vsize >> 2) & 0xFF},
+        {0x53, xoff & 0xFF},
+        {0x54, yoff & 0xFF},
+        {0x55, ((vsize >> 10) & 1) << 7 | ((yoff >> 8) & 7) << 4 | ((hsize >> 10) & 1) << 3 | ((xoff >> 8) & 7)},
+        {0x5A, zmow & 0xFF},
+        {0x5B, zmoh & 0xFF},
+        {0x5C, ((zmoh >> 8) & 1) << 2 | ((zmow >> 8) & 3)},
+        {0xE0, 0x00},
+        {0x00, 0x00}
+    };
+
+    sensor_regs_apply(&ov2640_regs, window, 0);
+    return 0;
+}
+
+int ov2640_set_frame_div(uint8_t div)
+{
+    if (div < 1 || div > 64)
+        return -1;
+    /* CLKRC[5:0] divides the sensor clock, and the frame rate with it */
+    sensor_regs_write(&ov2640_regs, 0xFF, 0x01, 0);
+    sensor_regs_write(&ov2640_regs, 0x11, div - 1, 0);
+    return 0;
+}
+
+int ov2640_set_manual(int manual)
+{
+    sensor_regs_t *regs = &ov2640_regs;
+
+    /* Whoever ran the loop so far, the cached gain and exposure may be stale */
+    sensor_regs_write(regs, 0xFF, 0x01, 0);
+    sensor_regs_forget(regs, 0x00);
+    sensor_regs_forget(regs, 0x04);
+    sensor_regs_forget(regs, 0x10);
+    sensor_regs_forget(regs, 0x45);
+    /* COM8[2,0] are AGC and AEC, CTRL3[6] turns AWB off */
+    sensor_regs_update(regs, 0x13, 0x05, manual ? 0x00 : 0x05, 0);
+    sensor_regs_write(regs, 0xFF, 0x00, 0);
+    sensor_regs_forget(regs, 0xCC);
+    sensor_regs_forget(regs, 0xCD);
+    sensor_regs_forget(regs, 0xCE);
+    sensor_regs_update(regs, 0xC7, 0x40, manual ? 0x40 : 0x00, 0);
+    return 0;
+}
+
+int ov2640_set_exposure(uint16_t lines)
+{
+    sensor_regs_t *regs = &ov2640_regs;
+
+    /* AEC[15:10] in REG45, AEC[9:2] in AEC, AEC[1:0] in REG04 */
+    sensor_regs_write(regs, 0xFF, 0x01, 0);
+    sensor_regs_update(regs, 0x45, 0x3F, lines >> 10, 0);
+    sensor_regs_write(regs, 0x10, (lines >> 2) & 0xFF, 0);
+    sensor_regs_update(regs, 0x04, 0x03, lines, 0);
+    return 0;
+}
+
+int ov2640_set_gain(uint8_t gain)
+{
+    uint8_t value = 0;
+    uint8_t doubling = 0x10;
+
+    if (gain < 16)
+        gain = 16;
+    /* GAIN[7:4] each double, GAIN[3:0] adds sixteenths: (1 + [3:0] / 16) * 2^n */
+    while (gain >= 32 && doubling)
+    {
+        value |= doubling;
+        doubling <<= 1;
+        gain /= 2;
+    }
+    value |= gain >= 32 ? 0x0F : gain - 16;
+    sensor_regs_write(&ov2640_regs, 0xFF, 0x01, 0);
+    sensor_regs_write(&ov2640_regs, 0x00, value, 0);
+    return 0;
+}
+
+int ov2640_set_white_balance(uint8_t r, uint8_t g, uint8_t b)
+{
+    sensor_regs_write(&ov2640_regs, 0xFF, 0x00, 0);
+    sensor_regs_write(&ov2640_regs, 0xCC, r, 0);
+    sensor_regs_write(&ov2640_regs, 0xCD, g, 0);
+    sensor_regs_write(&ov2640_regs, 0xCE, b, 0);
     return 0;
 }
 
 int ov2640_read_id(uint16_t *manuf_id, uint16_t *device_id)
 {
-    dvp_sccb_send_data(OV2640_ADDR, 0xFF, 0x01);
+    sensor_regs_write(&ov2640_regs, 0xFF, 0x01, 0);
     *manuf_id = (dvp_sccb_receive_data(OV2640_ADDR, 0x1C) << 8) | dvp_sccb_receive_data(OV2640_ADDR, 0x1D);
     *device_id = (dvp_sccb_receive_data(OV2640_ADDR, 0x0A) << 8) | dvp_sccb_receive_data(OV2640_ADDR, 0x0B);
     return 0;
@@ -16,11 +16,40 @@
 #define _OV2640_H
 
 #include <stdint.h>
+#include "sensor_regs.h"
 
 #define OV2640_ADDR         0x60
+/* Coordinates of ov2640_set_window: the full field of view at the init table's output size */
+#define OV2640_VIEW_WIDTH   320
+#define OV2640_VIEW_HEIGHT  240
+/* Longest exposure in lines that still fits the SVGA frame */
+#define OV2640_EXPOSURE_MAX 0x290
+/* Highest gain worth asking ov2640_set_gain for (16 = 1x): 8x, beyond which it is mostly noise */
+#define OV2640_GAIN_MAX     (16 * 8)
 
 int ov2640_init(void);
 int ov2640_read_id(uint16_t *manuf_id, uint16_t *device_id);
+/*
+ * Capture the window x, y, width, height of the field of view, scaled by the
+ * DSP to out_width x out_height. The window must map to a multiple of 4
+ * DSP input pixels (a multiple of 8 view pixels always does) and the output
+ * to a multiple of 4, no larger than the window.
+ */
+int ov2640_set_window(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint16_t out_width,
+                      uint16_t out_height);
+/* Run the sensor at 1/div of its full frame rate */
+int ov2640_set_frame_div(uint8_t div);
+/*
+ * Manual exposure for a software control loop: with manual set the sensor's
+ * AEC, AGC and AWB stop and the values below take effect. Gain is 16 for
+ * 1x, white balance gains 64 for 1x.
+ */
+int ov2640_set_manual(int manual);
+int ov2640_set_exposure(uint16_t lines);
+int ov2640_set_gain(uint8_t gain);
+int ov2640_set_white_balance(uint8_t r, uint8_t g, uint8_t b);
+/* Register cache shared by everything that reconfigures the sensor */
+sensor_regs_t *ov2640_get_regs(void);
 
 #endif /* _OV2640_H */
 
@@ -0,0 +1,373 @@
+#include <stddef.h>
+#include "board_config.h"
+#include "encoding.h"
+#include "sensor_bus.h"
+#if (BOARD_VERSION == BOARD_V1_3)
+#include "i2c.h"
+#include "plic.h"
+#else
+#include "dvp.h"
+#include "timer.h"
+#endif
+
+#if (BOARD_VERSION == BOARD_V1_3)
+/* Both GC0328s hang off I2C0, routed by the SDA pin mux */
+#define SENSOR_BUS_I2C      I2C_DEVICE_0
+#else
+/* A 3-byte SCCB transfer takes about 270us at the DVP's default clock */
+#define SENSOR_BUS_TIMER    TIMER_DEVICE_2
+#define SENSOR_BUS_CHANNEL  TIMER_CHANNEL_0
+#define SENSOR_BUS_POLL_NS  50000
+#endif
+
+static struct {
+    const sensor_bus_config_t* config;
+    /* Queued batches, urgent ones first; the running one stays linked */
+    sensor_bus_batch_t* head;
+    /* Owner of the op on the bus, not always the head after an urgent submit */
+    sensor_bus_batch_t* current;
+    sensor_bus_batch_t* open;
+    volatile uint8_t running;
+    volatile uint8_t locked;
+    uint8_t phase;
+    sensor_bus_stats_t stats;
+} bus;
+
+static unsigned long sensor_bus_irq_off(void) {
+    return clear_csr(mstatus, MSTATUS_MIE) & MSTATUS_MIE;
+}
+
+static void sensor_bus_irq_restore(unsigned long irq_state) {
+    set_csr(mstatus, irq_state);
+}
+
+static sensor_bus_op_t* sensor_bus_current_op(void) {
+    return &bus.current->ops[bus.current->done];
+}
+
+#if (BOARD_VERSION == BOARD_V1_3)
+
+static void sensor_bus_backend_start(const sensor_bus_op_t* op) {
+    volatile i2c_t* adapter = i2c[SENSOR_BUS_I2C];
+
+    (void)adapter->clr_intr;
+    adapter->intr_mask = I2C_INTR_MASK_STOP_DET | I2C_INTR_MASK_TX_ABRT;
+    /* The controller restarts on the change of direction and stops when the FIFO drains */
+    adapter->data_cmd = I2C_DATA_CMD_DATA(op->reg);
+    adapter->data_cmd = op->read ? I2C_DATA_CMD_CMD : I2C_DATA_CMD_DATA(op->value);
+}
+
+static void sensor_bus_backend_idle(void) {
+    i2c[SENSOR_BUS_I2C]->intr_mask = 0;
+}
+
+static void sensor_bus_complete(int failed);
+
+static int sensor_bus_irq(void* ctx) {
+    volatile i2c_t* adapter = i2c[SENSOR_BUS_I2C];
+    uint32_t status = adapter->intr_stat;
+    sensor_bus_op_t* op;
+    int failed;
+
+    (void)ctx;
+    if (!bus.running || !(status & (I2C_INTR_STAT_STOP_DET | I2C_INTR_STAT_TX_ABRT)))
+        return 0;
+
+    /* An abort also ends in a STOP; let it go out before the next op starts */
+    while (adapter->status & I2C_STATUS_ACTIVITY)
+        ;
+    failed = (status & I2C_INTR_STAT_TX_ABRT) != 0;
+    op = sensor_bus_current_op();
+    if (!failed && op->read) {
+        if (adapter->status & I2C_STATUS_RFNE)
+            op->value = adapter->data_cmd & I2C_DATA_CMD_DATA_MASK;
+        else
+            failed = 1;
+    }
+    (void)adapter->clr_intr;
+    sensor_bus_complete(failed);
+    return 0;
+}
+
+static void sensor_bus_backend_init(void) {
+    plic_set_priority(IRQN_I2C0_INTERRUPT, 1);
+    plic_irq_register(IRQN_I2C0_INTERRUPT, sensor_bus_irq, NULL);
+    plic_irq_enable(IRQN_I2C0_INTERRUPT);
+}
+
+#else
+
+static void sensor_bus_sccb_start(uint32_t bytes, uint32_t ctl) {
+    dvp->sccb_cfg = (dvp->sccb_cfg & ~DVP_SCCB_BYTE_NUM_MASK) | bytes;
+    dvp->sccb_ctl = ctl;
+    dvp->sts = DVP_STS_SCCB_EN | DVP_STS_SCCB_EN_WE;
+}
+
+static void sensor_bus_backend_start(const sensor_bus_op_t* op) {
+    uint32_t ctl = DVP_SCCB_WRITE_DATA_ENABLE | DVP_SCCB_DEVICE_ADDRESS(bus.config->address) |
+                   DVP_SCCB_REG_ADDRESS(op->reg);
+
+    /* A read is a register address write followed by a read transfer */
+    bus.phase = 0;
+    if (op->read)
+        sensor_bus_sccb_start(DVP_SCCB_BYTE_NUM_2, ctl);
+    else
+        sensor_bus_sccb_start(DVP_SCCB_BYTE_NUM_3, ctl | DVP_SCCB_WDATA_BYTE0(op->value));
+    timer_set_enable(SENSOR_BUS_TIMER, SENSOR_BUS_CHANNEL, 1);
+}
+
+static void sensor_bus_backend_idle(void) {
+    timer_set_enable(SENSOR_BUS_TIMER, SENSOR_BUS_CHANNEL, 0);
+}
+
+static void sensor_bus_complete(int failed);
+
+/* The SCCB engine has no interrupt, so a timer checks whether it is done */
+static int sensor_bus_poll(void* ctx) {
+    sensor_bus_op_t* op;
+
+    if (!bus.running || (dvp->sts & DVP_STS_SCCB_EN))
+        return 0;
+
+    op = sensor_bus_current_op();
+    if (op->read && bus.phase == 0) {
+        bus.phase = 1;
+        dvp->sccb_ctl = DVP_SCCB_DEVICE_ADDRESS(bus.config->address);
+        dvp->sts = DVP_STS_SCCB_EN | DVP_STS_SCCB_EN_WE;
+        return 0;
+    }
+    if (op->read)
+        op->value = DVP_SCCB_RDATA_BYTE(dvp->sccb_cfg);
+    /* SCCB does not acknowledge, so there is nothing to fail on */
+    sensor_bus_complete(0);
+    return 0;
+}
+
+static void sensor_bus_backend_init(void) {
+    timer_init(SENSOR_BUS_TIMER);
+    timer_set_interval(SENSOR_BUS_TIMER, SENSOR_BUS_CHANNEL, SENSOR_BUS_POLL_NS);
+    timer_irq_register(SENSOR_BUS_TIMER, SENSOR_BUS_CHANNEL, 0, 1, sensor_bus_poll, NULL);
+    timer_set_enable(SENSOR_BUS_TIMER, SENSOR_BUS_CHANNEL, 0);
+}
+
+#endif
+
+/* Interrupts off; puts the next op on the bus or lets it go idle */
+static void sensor_bus_start(void) {
+    sensor_bus_batch_t* batch = bus.head;
+    sensor_bus_op_t* op;
+
+    if (!batch || bus.locked) {
+        bus.running = 0;
+        sensor_bus_backend_idle();
+        return;
+    }
+    bus.running = 1;
+    bus.current = batch;
+    batch->state = SENSOR_BUS_RUNNING;
+    op = sensor_bus_current_op();
+    if (bus.config->select)
+        bus.config->select(op->device);
+    sensor_bus_backend_start(op);
+}
+
+static void sensor_bus_unlink(sensor_bus_batch_t* batch) {
+    sensor_bus_batch_t** link = &bus.head;
+
+    while (*link && *link != batch)
+        link = &(*link)->next;
+    if (*link)
+        *link = batch->next;
+    batch->next = NULL;
+}
+
+static void sensor_bus_finish(sensor_bus_batch_t* batch, sensor_bus_state_t state) {
+    sensor_bus_unlink(batch);
+    batch->state = state;
+    if (state == SENSOR_BUS_FAILED)
+        bus.stats.failed++;
+    else
+        bus.stats.batches++;
+    /* The bus still counts as running, so a resubmit from here only queues */
+    if (batch->callback)
+        batch->callback(batch, batch->ctx);
+}
+
+/* From the backend's interrupt once the op on the bus is over */
+static void sensor_bus_complete(int failed) {
+    sensor_bus_batch_t* batch = bus.current;
+
+    bus.stats.ops++;
+    if (failed) {
+        /* The rest of the batch probably assumes this op took effect */
+        sensor_bus_finish(batch, SENSOR_BUS_FAILED);
+    } else if (++batch->done == batch->count) {
+        sensor_bus_finish(batch, SENSOR_BUS_DONE);
+    }
+    sensor_bus_start();
+}
+
+void sensor_bus_init(const sensor_bus_config_t* config) {
+    bus.config = config;
+    bus.head = NULL;
+    bus.current = NULL;
+    bus.open = NULL;
+    bus.running = 0;
+    bus.locked = 0;
+    bus.stats = (sensor_bus_stats_t){0};
+    sensor_bus_backend_init();
+}
+
+void sensor_bus_batch_init(sensor_bus_batch_t* batch, sensor_bus_op_t* ops, uint16_t size) {
+    batch->ops = ops;
+    batch->size = size;
+    batch->count = 0;
+    batch->done = 0;
+    batch->state = SENSOR_BUS_IDLE;
+    batch->urgent = 0;
+    batch->callback = NULL;
+    batch->ctx = NULL;
+    batch->next = NULL;
+}
+
+static int sensor_bus_add(sensor_bus_batch_t* batch, uint8_t device, uint8_t read, uint8_t reg, uint8_t value) {
+    sensor_bus_op_t* op;
+
+    if (sensor_bus_pending(batch) || batch->count >= batch->size)
+        return -1;
+    op = &batch->ops[batch->count++];
+    op->device = device;
+    op->read = read;
+    op->reg = reg;
+    op->value = value;
+    return 0;
+}
+
+int sensor_bus_add_write(sensor_bus_batch_t* batch, uint8_t device, uint8_t reg, uint8_t value) {
+    return sensor_bus_add(batch, device, 0, reg, value);
+}
+
+int sensor_bus_add_read(sensor_bus_batch_t* batch, uint8_t device, uint8_t reg) {
+    return sensor_bus_add(batch, device, 1, reg, 0);
+}
+
+int sensor_bus_submit(sensor_bus_batch_t* batch, sensor_bus_done_t callback, void* ctx, int urgent) {
+    sensor_bus_batch_t** link = &bus.head;
+    unsigned long irq_state;
+
+    if (sensor_bus_pending(batch) || batch == bus.open)
+        return -1;
+
+    batch->done = 0;
+    batch->urgent = urgent != 0;
+    batch->callback = callback;
+    batch->ctx = ctx;
+    batch->next = NULL;
+    if (batch->count == 0) {
+        batch->state = SENSOR_BUS_DONE;
+        if (callback)
+            callback(batch, ctx);
+        return 0;
+    }
+
+    irq_state = sensor_bus_irq_off();
+    batch->state = SENSOR_BUS_QUEUED;
+    /* Urgent batches keep their order among themselves */
+    if (urgent) {
+        while (*link && (*link)->urgent)
+            link = &(*link)->next;
+    } else {
+        while (*link)
+            link = &(*link)->next;
+    }
+    batch->next = *link;
+    *link = batch;
+    if (!bus.running)
+        sensor_bus_start();
+    sensor_bus_irq_restore(irq_state);
+    return 0;
+}
+
+int sensor_bus_pending(const sensor_bus_batch_t* batch) {
+    return batch->state == SENSOR_BUS_QUEUED || batch->state == SENSOR_BUS_RUNNING;
+}
+
+int sensor_bus_wait(sensor_bus_batch_t* batch) {
+    while (sensor_bus_pending(batch))
+        ;
+    return batch->state == SENSOR_BUS_FAILED ? -1 : 0;
+}
+
+void sensor_bus_lock(void) {
+    for (;;) {
+        unsigned long irq_state = sensor_bus_irq_off();
+
+        if (!bus.running) {
+            bus.locked = 1;
+            sensor_bus_irq_restore(irq_state);
+            return;
+        }
+        sensor_bus_irq_restore(irq_state);
+    }
+}
+
+void sensor_bus_unlock(void) {
+    unsigned long irq_state = sensor_bus_irq_off();
+
+    bus.locked = 0;
+    if (!bus.running)
+        sensor_bus_start();
+    sensor_bus_irq_restore(irq_state);
+}
+
+int sensor_bus_locked(void) {
+    return bus.locked;
+}
+
+int sensor_bus_begin(sensor_bus_batch_t* batch) {
+    if (bus.open || sensor_bus_pending(batch))
+        return -1;
+    batch->count = 0;
+    batch->state = SENSOR_BUS_OPEN;
+    bus.open = batch;
+    return 0;
+}
+
+int sensor_bus_record(uint8_t device, uint8_t reg, uint8_t value) {
+    sensor_bus_batch_t* batch = bus.open;
+
+    if (!batch)
+        return -1;
+    /* A full batch goes out now and recording carries on behind it */
+    if (batch->count == batch->size)
+        sensor_bus_flush();
+    sensor_bus_add_write(batch, device, reg, value);
+    bus.stats.recorded++;
+    return 0;
+}
+
+void sensor_bus_flush(void) {
+    sensor_bus_batch_t* batch = bus.open;
+
+    if (!batch || batch->count == 0)
+        return;
+    bus.open = NULL;
+    sensor_bus_submit(batch, NULL, NULL, 0);
+    sensor_bus_wait(batch);
+    batch->count = 0;
+    batch->state = SENSOR_BUS_OPEN;
+    bus.open = batch;
+}
+
+int sensor_bus_end(sensor_bus_done_t callback, void* ctx) {
+    sensor_bus_batch_t* batch = bus.open;
+
+    if (!batch)
+        return -1;
+    bus.open = NULL;
+    return sensor_bus_submit(batch, callback, ctx, 0);
+}
+
+const sensor_bus_stats_t* sensor_bus_get_stats(void) {
+    return &bus.stats;
+}
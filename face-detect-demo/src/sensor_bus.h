@@ -0,0 +1,102 @@
+#ifndef _SENSOR_BUS_H
+#define _SENSOR_BUS_H
+
+#include <stdint.h>
+
+/*
+ * Asynchronous register access to the camera sensors. Batches of reads and
+ * writes are queued and run one transfer at a time from interrupts: the I2C0
+ * interrupt on boards with GC0328 sensors, a polling timer on boards where
+ * the DVP's SCCB engine talks to the sensor, as that engine raises none.
+ * Nothing is allocated; every batch and its ops belong to the caller and
+ * must stay valid until the batch completes.
+ */
+
+typedef struct _sensor_bus_op {
+    uint8_t device; /* handed to the select hook, e.g. the camera route */
+    uint8_t read;
+    uint8_t reg;
+    uint8_t value; /* written, or filled in by a read */
+} sensor_bus_op_t;
+
+typedef enum _sensor_bus_state {
+    SENSOR_BUS_IDLE,
+    SENSOR_BUS_OPEN,
+    SENSOR_BUS_QUEUED,
+    SENSOR_BUS_RUNNING,
+    SENSOR_BUS_DONE,
+    SENSOR_BUS_FAILED,
+} sensor_bus_state_t;
+
+struct _sensor_bus_batch;
+/* Called from the interrupt that finished the batch's last op */
+typedef void (*sensor_bus_done_t)(struct _sensor_bus_batch* batch, void* ctx);
+
+typedef struct _sensor_bus_batch {
+    sensor_bus_op_t* ops;
+    uint16_t size;
+    uint16_t count;
+    /* Ops completed; on failure the op at this index is the one that failed */
+    volatile uint16_t done;
+    volatile sensor_bus_state_t state;
+    uint8_t urgent;
+    sensor_bus_done_t callback;
+    void* ctx;
+    struct _sensor_bus_batch* next;
+} sensor_bus_batch_t;
+
+typedef struct _sensor_bus_config {
+    /* SCCB write address; the I2C backend keeps the target its owner set */
+    uint8_t address;
+    /* Route the bus to a device before its op; runs in interrupt context */
+    void (*select)(uint8_t device);
+} sensor_bus_config_t;
+
+typedef struct _sensor_bus_stats {
+    uint32_t batches;
+    uint32_t ops;
+    uint32_t failed;
+    uint32_t recorded;
+} sensor_bus_stats_t;
+
+void sensor_bus_init(const sensor_bus_config_t* config);
+void sensor_bus_batch_init(sensor_bus_batch_t* batch, sensor_bus_op_t* ops, uint16_t size);
+/* Append to a batch that is not queued; -1 when it is full or in flight */
+int sensor_bus_add_write(sensor_bus_batch_t* batch, uint8_t device, uint8_t reg, uint8_t value);
+int sensor_bus_add_read(sensor_bus_batch_t* batch, uint8_t device, uint8_t reg);
+/*
+ * Queue a batch and start the bus if it is idle. Urgent batches go to the
+ * head of the queue and run as soon as the current op is done, between the
+ * ops of another batch, so they must not change state later ops rely on,
+ * such as a register page. Safe from interrupts. Returns -1 if the batch
+ * is still in flight; an empty batch completes at once.
+ */
+int sensor_bus_submit(sensor_bus_batch_t* batch, sensor_bus_done_t callback, void* ctx, int urgent);
+int sensor_bus_pending(const sensor_bus_batch_t* batch);
+/* Spin until the batch completes; returns 0 or -1 if an op failed */
+int sensor_bus_wait(sensor_bus_batch_t* batch);
+
+/*
+ * Exclusive use of the bus for a blocking driver transfer: waits for the
+ * queue to drain and holds back anything submitted meanwhile until unlock.
+ */
+void sensor_bus_lock(void);
+void sensor_bus_unlock(void);
+int sensor_bus_locked(void);
+
+/*
+ * Recording: while a batch is open, sensor_bus_record appends the writes of
+ * driver callbacks to it instead of sending them, so a group of sensor_regs
+ * calls turns into one batch submitted by sensor_bus_end. begin fails if the
+ * batch is still in flight from last time. A driver that must read while
+ * recording calls sensor_bus_flush first to keep the bus order.
+ */
+int sensor_bus_begin(sensor_bus_batch_t* batch);
+/* Returns -1 when no batch is open and the caller should write itself */
+int sensor_bus_record(uint8_t device, uint8_t reg, uint8_t value);
+void sensor_bus_flush(void);
+int sensor_bus_end(sensor_bus_done_t callback, void* ctx);
+
+const sensor_bus_stats_t* sensor_bus_get_stats(void);
+
+#endif /* _SENSOR_BUS_H */
@@ -0,0 +1,112 @@
+#include <string.h>
+#include "sensor_regs.h"
+
+#define BANK_UNKNOWN 0xFF
+
+static int sensor_regs_known(sensor_regs_t* regs, uint8_t reg) {
+    return regs->known[regs->bank][reg >> 3] & (1 << (reg & 7));
+}
+
+static void sensor_regs_remember(sensor_regs_t* regs, uint8_t reg, uint8_t value) {
+    regs->value[regs->bank][reg] = value;
+    regs->known[regs->bank][reg >> 3] |= 1 << (reg & 7);
+}
+
+static int sensor_regs_is_port(const sensor_regs_config_t* config, uint8_t reg) {
+    for (uint8_t i = 0; i < config->port_count; i++) {
+        if (config->ports[i] == reg)
+            return 1;
+    }
+    return 0;
+}
+
+void sensor_regs_init(sensor_regs_t* regs, const sensor_regs_config_t* config, void* ctx) {
+    regs->config = config;
+    regs->ctx = ctx;
+    memset(&regs->stats, 0, sizeof(regs->stats));
+    sensor_regs_invalidate(regs);
+}
+
+void sensor_regs_invalidate(sensor_regs_t* regs) {
+    regs->bank = BANK_UNKNOWN;
+    memset(regs->known, 0, sizeof(regs->known));
+}
+
+void sensor_regs_write(sensor_regs_t* regs, uint8_t reg, uint8_t value, int flags) {
+    const sensor_regs_config_t* config = regs->config;
+    uint8_t bank = value & config->bank_mask;
+    uint8_t readback = value;
+    int cacheable;
+
+    if (reg == config->bank_reg) {
+        if (reg == config->reset_reg && (value & config->reset_mask)) {
+            /* Resetting through the bank register also returns to its default page */
+            config->write(regs->ctx, reg, value);
+            regs->stats.writes++;
+            sensor_regs_invalidate(regs);
+            regs->bank = bank;
+            return;
+        }
+        if (regs->bank == bank && !(flags & SENSOR_REGS_FORCE)) {
+            regs->stats.skipped++;
+            return;
+        }
+        config->write(regs->ctx, reg, value);
+        regs->stats.writes++;
+        regs->bank = bank < SENSOR_REGS_MAX_BANKS ? bank : BANK_UNKNOWN;
+        return;
+    }
+
+    /* With the page unknown or through an indirect window nothing can be cached */
+    cacheable = regs->bank != BANK_UNKNOWN && !sensor_regs_is_port(config, reg);
+    if (cacheable && reg == config->reset_reg && regs->bank == config->reset_bank && (value & config->reset_mask)) {
+        config->write(regs->ctx, reg, value);
+        regs->stats.writes++;
+        sensor_regs_invalidate(regs);
+        return;
+    }
+    if (cacheable && !(flags & SENSOR_REGS_FORCE) && sensor_regs_known(regs, reg) &&
+        regs->value[regs->bank][reg] == value) {
+        regs->stats.skipped++;
+        return;
+    }
+
+    config->write(regs->ctx, reg, value);
+    regs->stats.writes++;
+    if ((flags & SENSOR_REGS_VERIFY) && config->read) {
+        readback = config->read(regs->ctx, reg);
+        if (readback != value) {
+            config->write(regs->ctx, reg, value);
+            regs->stats.writes++;
+            readback = config->read(regs->ctx, reg);
+            if (readback != value)
+                regs->stats.verify_failed++;
+        }
+    }
+    /* Cache what the sensor really holds */
+    if (cacheable)
+        sensor_regs_remember(regs, reg, readback);
+}
+
+void sensor_regs_update(sensor_regs_t* regs, uint8_t reg, uint8_t mask, uint8_t value, int flags) {
+    uint8_t current;
+
+    if (regs->bank != BANK_UNKNOWN && sensor_regs_known(regs, reg))
+        current = regs->value[regs->bank][reg];
+    else
+        current = regs->config->read(regs->ctx, reg);
+    sensor_regs_write(regs, reg, (current & ~mask) | (value & mask), flags);
+}
+
+void sensor_regs_forget(sensor_regs_t* regs, uint8_t reg) {
+    if (regs->bank != BANK_UNKNOWN)
+        regs->known[regs->bank][reg >> 3] &= ~(1 << (reg & 7));
+}
+
+uint32_t sensor_regs_apply(sensor_regs_t* regs, const uint8_t (*table)[2], int flags) {
+    uint32_t writes = regs->stats.writes;
+
+    for (; table[0][0]; table++)
+        sensor_regs_write(regs, table[0][0], table[0][1], flags);
+    return regs->stats.writes - writes;
+}
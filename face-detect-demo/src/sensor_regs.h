@@ -0,0 +1,73 @@
+#ifndef _SENSOR_REGS_H
+#define _SENSOR_REGS_H
+
+#include <stdint.h>
+
+/* clang-format off */
+#define SENSOR_REGS_MAX_BANKS   4
+
+/* Write flags */
+/* Read the register back after writing */
+#define SENSOR_REGS_VERIFY      0x01
+/* Write even what the cache already holds, e.g. vendor bring-up sequences */
+#define SENSOR_REGS_FORCE       0x02
+/* clang-format on */
+
+typedef void (*sensor_reg_write_t)(void* ctx, uint8_t reg, uint8_t value);
+typedef uint8_t (*sensor_reg_read_t)(void* ctx, uint8_t reg);
+
+/*
+ * How a sensor pages its registers and how it is soft-reset. Ports are the
+ * data registers of indirect windows (gamma curves, AWB tables), where
+ * every write lands somewhere new, and registers shared across banks or
+ * changed behind the cache's back. They are always written through.
+ */
+typedef struct _sensor_regs_config {
+    uint8_t bank_reg;
+    uint8_t bank_mask;
+    uint8_t reset_bank;
+    uint8_t reset_reg;
+    uint8_t reset_mask;
+    uint8_t port_count;
+    const uint8_t* ports;
+    sensor_reg_write_t write;
+    sensor_reg_read_t read;
+} sensor_regs_config_t;
+
+typedef struct _sensor_regs_stats {
+    uint32_t writes;
+    uint32_t skipped;
+    uint32_t verify_failed;
+} sensor_regs_stats_t;
+
+/*
+ * Shadow copy of a sensor's register file. Writes of a value the cache
+ * already holds never reach the bus, so applying a whole profile table only
+ * sends the registers that differ from what the sensor has now. A write that
+ * soft-resets the sensor clears the cache. With SENSOR_REGS_VERIFY, each
+ * register is read back after writing, and a mismatch is retried once before
+ * being counted. SENSOR_REGS_FORCE sends every write, page switches
+ * included, and still records the values, so an init sequence that writes a
+ * register twice reaches the sensor unchanged.
+ */
+typedef struct _sensor_regs {
+    const sensor_regs_config_t* config;
+    void* ctx;
+    uint8_t bank;
+    uint8_t value[SENSOR_REGS_MAX_BANKS][256];
+    uint8_t known[SENSOR_REGS_MAX_BANKS][256 / 8];
+    sensor_regs_stats_t stats;
+} sensor_regs_t;
+
+void sensor_regs_init(sensor_regs_t* regs, const sensor_regs_config_t* config, void* ctx);
+/* Forget everything, e.g. after a hardware reset or power cycle */
+void sensor_regs_invalidate(sensor_regs_t* regs);
+void sensor_regs_write(sensor_regs_t* regs, uint8_t reg, uint8_t value, int flags);
+/* Change the bits in mask, reading the register first only if it is not cached */
+void sensor_regs_update(sensor_regs_t* regs, uint8_t reg, uint8_t mask, uint8_t value, int flags);
+/* Drop one register of the current bank, e.g. one the sensor's own control loops change */
+void sensor_regs_forget(sensor_regs_t* regs, uint8_t reg);
+/* Write a {reg, value} table ending at register 0; returns bus writes issued */
+uint32_t sensor_regs_apply(sensor_regs_t* regs, const uint8_t (*table)[2], int flags);
+
+#endif /* _SENSOR_REGS_H */